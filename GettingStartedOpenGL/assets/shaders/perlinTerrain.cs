@@ -0,0 +1,74 @@
+// Compute Shader
+// Bakes the same fbm heights as perlinTerrain.vs once into a texture, normal in xyz and height in w
+#version 450 core
+layout (local_size_x = 16, local_size_y = 16) in;
+
+layout (binding = 0, rgba32f) uniform writeonly image2D u_heightmap;
+
+uniform float u_world_size;
+uniform float u_height_scale;
+uniform float u_noise_scale;
+uniform vec2 u_noise_offset;
+
+float random (in vec2 st) {
+    return fract(sin(dot(st.xy,
+                         vec2(12.9898,78.233)))*
+        43758.5453123);
+}
+
+// Based on Morgan McGuire @morgan3d
+// https://www.shadertoy.com/view/4dS3Wd
+float noise (in vec2 st) {
+    vec2 i = floor(st);
+    vec2 f = fract(st);
+
+    // Four corners in 2D of a tile
+    float a = random(i);
+    float b = random(i + vec2(1.0, 0.0));
+    float c = random(i + vec2(0.0, 1.0));
+    float d = random(i + vec2(1.0, 1.0));
+
+    vec2 u = f * f * (3.0 - 2.0 * f);
+
+    return mix(a, b, u.x) +
+            (c - a)* u.y * (1.0 - u.x) +
+            (d - b) * u.x * u.y;
+}
+
+#define OCTAVES 6
+float fbm (in vec2 st) {
+    float value = 0.0;
+    float amplitude = 1.5;
+    for (int i = 0; i < OCTAVES; i++) {
+        value += amplitude * noise(st);
+        st *= 2.;
+        amplitude *= .5;
+    }
+    return value;
+}
+
+float height(in ivec2 texel, in vec2 resolution) {
+    vec2 st = vec2(texel) / resolution * u_noise_scale + u_noise_offset;
+    return fbm(st) * 2.0 * u_height_scale;
+}
+
+void main() {
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = imageSize(u_heightmap);
+    if (texel.x >= size.x || texel.y >= size.y) {
+        return;
+    }
+
+    vec2 resolution = vec2(size);
+    float myHeight = height(texel, resolution);
+    float leftHeight = height(texel - ivec2(1, 0), resolution);
+    float rightHeight = height(texel + ivec2(1, 0), resolution);
+    float backHeight = height(texel - ivec2(0, 1), resolution);
+    float frontHeight = height(texel + ivec2(0, 1), resolution);
+
+    // Central differences over two texels in world units
+    float texelWorldSize = u_world_size / resolution.x;
+    vec3 normal = normalize(vec3(leftHeight - rightHeight, 2.0 * texelWorldSize, backHeight - frontHeight));
+
+    imageStore(u_heightmap, texel, vec4(normal, myHeight));
+}
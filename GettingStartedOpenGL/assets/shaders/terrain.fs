@@ -0,0 +1,78 @@
+// Fragment Shader
+#version 450 core
+layout (location = 0) in vec3 i_world_pos;
+layout (location = 1) in vec3 i_normal;
+
+out vec4 frag_color;
+
+uniform vec3 u_light_dir;
+
+// Clustered lights, see ClusteredLighting.h
+struct Light
+{
+    vec4 position_range;
+    vec4 color_intensity;
+    vec4 direction_cos_outer; // cos outer is -2 for point lights
+    vec4 cos_inner;
+};
+
+layout (std430, binding = 0) readonly buffer LightBuffer { Light lights[]; };
+layout (std430, binding = 1) readonly buffer ClusterBuffer { uvec2 clusters[]; }; // offset and count into light_indices
+layout (std430, binding = 2) readonly buffer LightIndexBuffer { uint light_indices[]; };
+
+uniform bool u_clustered_lighting;
+uniform ivec3 u_cluster_grid;
+uniform vec2 u_screen_size;
+uniform float u_near_plane;
+uniform float u_far_plane;
+
+uint clusterIndex()
+{
+    // View depth back from the depth buffer value of a standard perspective projection
+    float ndcDepth = gl_FragCoord.z * 2.0 - 1.0;
+    float viewDepth = 2.0 * u_near_plane * u_far_plane / (u_far_plane + u_near_plane - ndcDepth * (u_far_plane - u_near_plane));
+
+    // Same exponential slices as ClusteredLighting::SetProjection
+    int slice = int(log(viewDepth / u_near_plane) / log(u_far_plane / u_near_plane) * float(u_cluster_grid.z));
+    ivec2 tile = ivec2(gl_FragCoord.xy / u_screen_size * vec2(u_cluster_grid.xy));
+    ivec3 cluster = clamp(ivec3(tile, slice), ivec3(0), u_cluster_grid - 1);
+    return uint((cluster.z * u_cluster_grid.y + cluster.y) * u_cluster_grid.x + cluster.x);
+}
+
+vec3 clusteredLighting(vec3 normal, vec3 albedo)
+{
+    vec3 result = vec3(0.0);
+    uvec2 range = clusters[clusterIndex()];
+    for (uint i = range.x; i < range.x + range.y; i++)
+    {
+        Light light = lights[light_indices[i]];
+        vec3 toLight = light.position_range.xyz - i_world_pos;
+        float distance = length(toLight);
+        vec3 lightDir = toLight / max(distance, 1e-4);
+
+        // Smooth falloff that reaches zero at the range
+        float ratio = distance / light.position_range.w;
+        float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+        float attenuation = window * window / (distance * distance + 1.0);
+
+        float cone = smoothstep(light.direction_cos_outer.w, light.cos_inner.x, dot(-lightDir, light.direction_cos_outer.xyz));
+        float diffuse = max(dot(normal, lightDir), 0.0);
+        result += albedo * light.color_intensity.rgb * (light.color_intensity.w * attenuation * cone * diffuse);
+    }
+    return result;
+}
+
+void main()
+{
+    vec3 normal = normalize(i_normal);
+    float diffuse = max(dot(normal, -normalize(u_light_dir)), 0.0);
+
+    // Grass on flat ground, rock on the slopes
+    vec3 albedo = mix(vec3(0.45, 0.4, 0.35), vec3(0.3, 0.5, 0.2), smoothstep(0.6, 0.9, normal.y));
+    vec3 color = albedo * (0.2 + 0.8 * diffuse);
+    if (u_clustered_lighting)
+    {
+        color += clusteredLighting(normal, albedo);
+    }
+    frag_color = vec4(color, 1.0);
+}
@@ -0,0 +1,9 @@
+// Vertex Shader
+// Passes the patch corners through, the displacement happens in terrain.tes
+#version 450 core
+layout (location = 0) in vec3 i_pos_coord;
+
+void main()
+{
+    gl_Position = vec4(i_pos_coord, 1.0);
+}
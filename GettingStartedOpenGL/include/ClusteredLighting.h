@@ -0,0 +1,90 @@
+#pragma once
+#include "core.h"
+#include "ShaderProgram.h"
+#include "ThreadPool.h"
+
+enum class LightType : uint8
+{
+	Point,
+	Spot,
+};
+
+struct Light
+{
+	LightType type;
+	glm::vec3 position;
+	float range;
+	glm::vec3 color;
+	float intensity;
+	// Spot lights only, angles in radians from the direction
+	glm::vec3 direction;
+	float innerAngle;
+	float outerAngle;
+};
+
+// Clustered forward lighting. The view frustum is split into a grid of clusters, tiles on screen and exponential
+// slices in depth, and every light is binned on the CPU into the clusters its bounding sphere touches. Depth slices
+// are binned in parallel and each slice tests 4 clusters at a time with SSE. The lights, the per-cluster ranges and
+// the light index list go to shader storage buffers 0, 1 and 2 so a fragment only loops over the lights of its cluster.
+struct ClusteredLighting
+{
+	// Matches the std430 Light struct in the shaders
+	struct GpuLight
+	{
+		glm::vec4 positionRange;
+		glm::vec4 colorIntensity;
+		glm::vec4 directionCosOuter; // cos outer is -2 for point lights so every direction passes
+		glm::vec4 cosInner;
+	};
+
+	glm::ivec3 gridSize;
+	float nearPlane, farPlane;
+	glm::vec2 screenSize;
+	std::vector<Light> lights;
+
+	uint32 lightBuffer, clusterBuffer, lightIndexBuffer;
+	// Bytes allocated for each buffer, they only grow
+	uint64 lightBufferSize = 0, clusterBufferSize = 0, lightIndexBufferSize = 0;
+
+	double lastBinningMs = 0.0;
+	double lastUploadMs = 0.0;
+	uint32 numLightIndices = 0;
+
+	void Init(ThreadPool* threadPool, const glm::ivec3& gridSize = glm::ivec3(16, 9, 24));
+	void Destroy();
+
+	// Rebuilds the view-space bounds of every cluster, call again whenever the projection or the viewport changes
+	void SetProjection(const glm::mat4& projection, float nearPlane, float farPlane, const glm::vec2& screenSize);
+	// Bins the lights from this view on the CPU, no GL calls
+	void Bin(const glm::mat4& view);
+	// Uploads the lights and the binning results to the storage buffers
+	void Upload();
+
+	// Binds the storage buffers and uploads the cluster lookup uniforms, the program must be bound
+	void Bind(const ShaderProgram& program) const;
+
+private:
+	struct ClusterBounds
+	{
+		// Structure of arrays so 4 clusters can be tested at once, padded to a multiple of 4
+		std::vector<float> minX, minY, minZ, maxX, maxY, maxZ;
+	};
+	struct BoundingSphere
+	{
+		glm::vec3 center; // View space
+		float radius;
+	};
+
+	ThreadPool* threadPool;
+	std::vector<ClusterBounds> sliceBounds;
+	std::vector<float> sliceDepths; // gridSize.z + 1 view-space distances
+	std::vector<BoundingSphere> lightSpheres;
+	// Lights of every cluster, indexed like the grid, reused between frames to keep their capacity
+	std::vector<std::vector<uint32>> clusterLights;
+	std::vector<glm::uvec2> clusterRanges; // Offset and count into lightIndices
+	std::vector<uint32> lightIndices;
+	std::vector<GpuLight> gpuLights;
+
+	void BinSlice(int slice);
+	static void UploadToBuffer(uint32 buffer, uint64& capacity, const void* data, uint64 size);
+};
@@ -0,0 +1,20 @@
+#pragma once
+#include "core.h"
+#include "ShaderProgram.h"
+
+// A program made of a single compute stage. Uniform uploads, Bind and Destroy come from ShaderProgram.
+struct ComputeProgram : ShaderProgram
+{
+	// Local size declared in the shader with layout(local_size_x = ...), queried after linking
+	glm::ivec3 workGroupSize;
+
+	bool Compile(const char* computeShaderFile);
+
+	// Dispatches the given number of work groups, if barriers is non-zero glMemoryBarrier is issued right after
+	void Dispatch(uint32 numGroupsX, uint32 numGroupsY = 1, uint32 numGroupsZ = 1, GLbitfield barriers = 0) const;
+	// Dispatches enough work groups to cover the given number of invocations, the shader must bounds check the edges
+	void DispatchForSize(uint32 width, uint32 height = 1, uint32 depth = 1, GLbitfield barriers = 0) const;
+
+	// Makes writes from previous dispatches visible to the access types in barriers (GL_SHADER_IMAGE_ACCESS_BARRIER_BIT etc.)
+	static void Barrier(GLbitfield barriers);
+};
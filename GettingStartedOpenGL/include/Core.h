@@ -12,6 +12,7 @@
 #include <array>
 #include <fstream>
 #include <sstream>
+#include <cfloat>
 
 // GLM stuff
 #define GLM_EXT_INCLUDED
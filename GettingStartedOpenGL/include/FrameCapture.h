@@ -0,0 +1,85 @@
+#pragma once
+#include "core.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+
+// Reads the default framebuffer back without stalling: glReadPixels goes into a ring of persistently mapped
+// pixel pack buffers, a fence tells us a few frames later when the copy landed, and a worker thread encodes
+// the mapped memory straight out of the buffer (PNG through stb or raw RGBA video frames).
+struct FrameCapture
+{
+	static constexpr int kMaxRingSize = 8;
+
+	enum class SlotState : uint8
+	{
+		Free,
+		InFlight, // Waiting on the GPU
+		Encoding, // Owned by the worker thread
+	};
+
+	struct Slot
+	{
+		uint32 pbo;
+		GLsync fence;
+		uint8* mapped;
+		std::atomic<SlotState> state;
+		std::string screenshotPath; // Empty when the frame only goes to the video
+		std::ofstream* videoFile; // nullptr when the frame is only a screenshot
+	};
+
+	int width = 0, height = 0;
+	int ringSize = 0;
+	Slot slots[kMaxRingSize];
+	int nextSlot = 0;
+
+	std::string pendingScreenshotPath;
+	std::ofstream* videoFile = nullptr;
+
+	// Render thread cost of the last Capture call, plus running totals for the report
+	double lastCaptureMs = 0.0;
+	double totalCaptureMs = 0.0;
+	double maxCaptureMs = 0.0;
+	uint64 numCaptureCalls = 0;
+	uint64 numFramesCaptured = 0;
+	uint64 numFramesDropped = 0;
+
+	// The size is fixed here, call Resize when the framebuffer changes
+	bool Init(int width, int height, int ringSize = 3);
+	// Waits for every frame still in flight to be written out
+	void Destroy();
+	// Recreates the buffers for the new framebuffer size, the pixel buffer ids change. A recording stops since raw
+	// frames of different sizes can't share a file, a pending screenshot is kept.
+	bool Resize(int width, int height);
+
+	// The screenshot is taken on the next Capture call
+	void RequestScreenshot(const char* filepath);
+	// Raw RGBA8 frames, top row first, e.g. ffmpeg -f rawvideo -pix_fmt rgba -s <w>x<h> -i <file> out.mp4
+	bool StartRecording(const char* filepath);
+	// Waits for the frames still in flight so none of them get lost
+	void StopRecording();
+	bool IsRecording() const { return videoFile != nullptr; }
+
+	// Call after rendering and before swapping buffers, never blocks on the GPU or the worker
+	void Capture();
+	void PrintReport() const;
+
+private:
+	std::thread worker;
+	std::mutex queueMutex;
+	std::condition_variable queueCondition;
+	// A slot index to encode, or a video file to close once the frames before it are written
+	struct EncodeJob
+	{
+		int slot;
+		std::ofstream* closeFile;
+	};
+	std::deque<EncodeJob> encodeQueue;
+	bool stopWorker = false;
+
+	void CollectFinished(bool wait);
+	void PushJob(const EncodeJob& job);
+	void WorkerLoop();
+};
@@ -0,0 +1,85 @@
+#pragma once
+#include "core.h"
+#include "ThreadPool.h"
+
+struct BoundingBox
+{
+	glm::vec3 min;
+	glm::vec3 max;
+};
+
+// Software occlusion culling. Occluder triangles are rasterized into a small CPU depth buffer (SSE, in horizontal
+// bands across the thread pool), a min/max depth pyramid is built on top of it and every object's screen-space
+// bounding rectangle is tested against the pyramid before it gets submitted.
+// Depth is window-space z in [0, 1], smaller is nearer. Occluders must never be in front of the real surface they
+// stand for, otherwise visible objects get culled.
+// Coverage is sampled at pixel centers, but each covered pixel gets the farthest depth of its triangle within the pixel
+// and the buffer is dilated by a pixel before the pyramid is built, so a partly covered pixel at a silhouette or on a
+// sloped occluder never hides anything. The error left is a gap between occluders narrower than a pixel of this buffer,
+// which can still hide what shows through it. --validate-occlusion counts the samples of culled objects that pass the
+// full resolution depth test.
+struct OcclusionCuller
+{
+	struct Stats
+	{
+		int numObjects;
+		int numFrustumCulled;
+		int numOccluded;
+		double rasterizeMs;
+		double pyramidMs;
+		double testMs;
+	};
+
+	int width, height;
+	// Level 0 is the depth buffer itself, every next level halves the size down to 1x1
+	std::vector<std::vector<float>> minPyramid;
+	std::vector<std::vector<float>> maxPyramid;
+	std::vector<glm::ivec2> levelSizes;
+
+	Stats lastStats = {};
+	Stats totalStats = {};
+	uint64 numFrames = 0;
+
+	// Width is rounded up to a multiple of 4 for the SIMD rasterizer
+	void Init(int width, int height, ThreadPool* threadPool);
+	void Destroy();
+
+	// World-space triangle list, kept until replaced
+	void SetOccluders(const std::vector<glm::vec3>& vertices, const std::vector<uint32>& indices);
+
+	// Rasterizes the occluders from this view and rebuilds the pyramid
+	void Update(const glm::mat4& viewProjection);
+	// visible[i] is 1 if bounds[i] may be visible from the last Update
+	void Cull(const BoundingBox* bounds, int numObjects, std::vector<uint8>& visible);
+
+	bool IsVisible(const BoundingBox& bounds) const;
+	// Same answer as IsVisible but compares against every covered pixel of level 0 of the pyramid
+	bool IsVisibleBruteForce(const BoundingBox& bounds) const;
+
+	void PrintReport() const;
+
+private:
+	// Pixel rectangle (inclusive) and nearest depth of a projected box
+	struct ScreenRect
+	{
+		int minX, minY, maxX, maxY;
+		float minDepth;
+	};
+	enum class ProjectResult : uint8
+	{
+		OnScreen,
+		OffScreen,
+		CrossesNearPlane,
+	};
+
+	ThreadPool* threadPool;
+	glm::mat4 viewProjection;
+	std::vector<glm::vec3> occluderVertices;
+	std::vector<uint32> occluderIndices;
+	std::vector<glm::vec4> screenVertices; // Window-space xyz, w <= 0 when behind the near plane
+
+	void RasterizeBand(int minY, int maxY);
+	void BuildPyramid();
+	ProjectResult Project(const BoundingBox& bounds, ScreenRect& rect) const;
+	bool IsRectVisible(int level, int minX, int minY, int maxX, int maxY, const ScreenRect& rect) const;
+};
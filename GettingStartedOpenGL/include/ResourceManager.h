@@ -0,0 +1,49 @@
+#pragma once
+#include "core.h"
+#include "VramBudget.h"
+
+// Creates and tracks GPU textures and buffers against a VRAM budget. Textures loaded from a file can be
+// evicted: under pressure their high resolution levels are dropped by reallocating them at a lower resolution,
+// and they are reloaded from the file once they are used again and fit in the budget.
+struct ResourceManager
+{
+	VramBudget budget;
+	uint64 frameIndex = 0;
+	// Evicted textures never shrink below this size on their smallest side
+	uint32 minResidentSize = 64;
+
+	void Init(uint64 budgetBytes);
+	void Destroy();
+
+	// Returns 0 if the file could not be loaded, the texture is left unbound so the caller can set its parameters
+	uint32 LoadTexture2D(const char* filepath, GLenum internalFormat, bool evictable = true);
+	void DestroyTexture(uint32 textureId);
+	// For textures created elsewhere (render targets, compute outputs...), they are accounted for but never evicted
+	void TrackTexture(uint32 textureId, uint32 width, uint32 height, GLenum internalFormat, int numLevels, ResourceCategory category);
+	void UntrackTexture(uint32 textureId);
+
+	// Call after glBufferData, calling it again for the same buffer replaces the old size
+	void TrackBuffer(uint32 bufferId, uint64 size, ResourceCategory category);
+	void UntrackBuffer(uint32 bufferId);
+
+	// Binds to the active texture unit and marks the texture as used this frame
+	void BindTexture(uint32 textureId);
+	// Runs the eviction policy and applies its decisions, call once per frame after all draws
+	void EndFrame();
+
+	void PrintMemoryReport() const;
+
+	// Bytes per pixel of a sized internal format as drivers store it, three channel formats are padded to four
+	static uint32 BytesPerPixel(GLenum internalFormat);
+
+private:
+	struct TextureSource
+	{
+		std::string filepath;
+		GLenum internalFormat;
+	};
+	robin_hood::unordered_map<uint32, TextureSource> textureSources;
+	std::vector<ResidencyChange> pendingChanges;
+
+	bool UploadFromSource(uint32 textureId, const TextureSource& source, int baseLevel, uint32* outWidth, uint32* outHeight);
+};
@@ -0,0 +1,6 @@
+#pragma once
+#include "core.h"
+
+// Checks of the CPU-side systems that don't need a GL context, run with --self-test before any window is created.
+// Every failed check gets printed, returns false if any of them failed.
+bool RunSelfTests();
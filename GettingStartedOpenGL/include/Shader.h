@@ -5,6 +5,10 @@ enum class ShaderType : uint8
 {
 	Vertex,
 	Fragment,
+	TessControl,
+	TessEvaluation,
+	Geometry,
+	Compute,
 };
 
 struct Shader
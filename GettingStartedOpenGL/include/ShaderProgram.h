@@ -1,13 +1,24 @@
 #ifndef MINECRAFT_CLONE_SHADER_PROGRAM_H
 #define MINECRAFT_CLONE_SHADER_PROGRAM_H
 #include "core.h"
+#include "Shader.h"
 
+// One stage of a program, the file is compiled as the given type
+struct ShaderStageFile
+{
+	ShaderType type;
+	const char* filepath;
+};
 
 struct ShaderProgram
 {
 	uint32 programId;
 
 	bool CompileAndLink(const char* vertexShaderFile, const char* fragmentShaderFile);
+	// Geometry shader is optional, pass nullptr to skip it
+	bool CompileAndLink(const char* vertexShaderFile, const char* tessControlShaderFile, const char* tessEvaluationShaderFile,
+		const char* geometryShaderFile, const char* fragmentShaderFile);
+	bool CompileAndLink(const ShaderStageFile* stages, int numStages);
 	void Bind() const;
 	void Unbind() const;
 	void Destroy();
@@ -0,0 +1,53 @@
+#pragma once
+#include "core.h"
+#include "ShaderProgram.h"
+#include "ComputeProgram.h"
+#include "OcclusionCuller.h"
+#include "ClusteredLighting.h"
+
+// Heightmap terrain, the noise is baked once into a texture by a compute shader and the
+// flat patch grid is displaced by the tessellation stages with distance-adaptive levels.
+struct Terrain
+{
+	ComputeProgram bakeProgram;
+	ShaderProgram drawProgram;
+
+	// RGBA32F, normal in rgb and height in a
+	uint32 heightmapTexture;
+	int heightmapResolution;
+
+	uint32 patchVAO, patchVBO;
+	int patchesPerSide;
+	float worldSize;
+
+	float minTessLevel = 1.0f;
+	float maxTessLevel = 32.0f;
+	float minDistance = 2.0f;
+	float maxDistance = 40.0f;
+
+	// Filled from the baked heights, patch i covers the vertices [i * 4, i * 4 + 4)
+	std::vector<BoundingBox> patchBounds;
+	// Stepped surface at the lowest height of every patch, it never rises above the real terrain
+	// so it can only hide what the terrain hides as long as the camera is above the ground
+	std::vector<glm::vec3> occluderVertices;
+	std::vector<uint32> occluderIndices;
+
+	bool Init(int heightmapResolution, int patchesPerSide, float worldSize);
+	// Regenerates the heightmap, only needed again if the noise parameters change.
+	// Reads the heights back to rebuild the culling data, which waits for the GPU.
+	void Bake(float heightScale, float noiseScale, const glm::vec2& noiseOffset);
+	// Only the patches with a non-zero entry in visiblePatches are drawn, all of them if it is nullptr.
+	// Without lighting only the sun lights the terrain.
+	void Draw(const glm::mat4& viewProjection, const glm::vec3& cameraPos, const std::vector<uint8>* visiblePatches = nullptr,
+		const ClusteredLighting* lighting = nullptr) const;
+	void Destroy();
+
+	// Reads the baked heights back to the CPU, row by row
+	void ReadHeights(std::vector<float>& heights) const;
+	// Bounds of the patch under the given point, nullptr outside the terrain
+	const BoundingBox* PatchBoundsAt(const glm::vec3& position) const;
+	glm::vec2 ReadHeightRange() const;
+
+private:
+	void BuildCullingData();
+};
@@ -0,0 +1,35 @@
+#pragma once
+#include "core.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+// Persistent worker threads for splitting per-frame CPU work, the calling thread helps out too
+struct ThreadPool
+{
+	// 0 picks one less than the number of hardware threads
+	void Init(int numWorkers = 0);
+	void Destroy();
+
+	// Runs task(i) for every i in [0, count) across the workers and returns once all of them finished
+	void ParallelFor(int count, const std::function<void(int)>& task);
+
+	int NumThreads() const { return (int)workers.size() + 1; }
+
+private:
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wakeCondition;
+	std::condition_variable doneCondition;
+	const std::function<void(int)>* currentTask = nullptr;
+	int taskCount = 0;
+	std::atomic<int> nextIndex = 0;
+	int numBusyWorkers = 0;
+	uint64 generation = 0;
+	bool stopping = false;
+
+	void RunTasks();
+	void WorkerLoop();
+};
@@ -0,0 +1,80 @@
+#pragma once
+#include "core.h"
+
+enum class ResourceCategory : uint8
+{
+	Texture,
+	RenderTarget,
+	VertexBuffer,
+	IndexBuffer,
+	UniformBuffer,
+	StorageBuffer,
+	PixelBuffer,
+	Count,
+};
+
+struct TrackedTexture
+{
+	uint32 textureId;
+	uint32 width, height; // Size of the full resolution level 0
+	uint32 bytesPerPixel;
+	int numLevels;
+	// Highest resolution level currently resident, 0 means fully resident
+	int residentBaseLevel;
+	// How many levels may be dropped under pressure, 0 means never evicted
+	int maxBaseLevel;
+	uint64 lastUsedFrame;
+	ResourceCategory category;
+};
+
+struct TrackedBuffer
+{
+	uint32 bufferId;
+	uint64 size;
+	ResourceCategory category;
+};
+
+struct ResidencyChange
+{
+	uint32 textureId;
+	int oldBaseLevel;
+	int newBaseLevel;
+};
+
+// Byte accounting for every texture and buffer against a budget, plus the LRU policy that decides
+// which mip levels to drop or restore. It makes no GL calls so the policy can be exercised without a GPU,
+// the ResourceManager applies the changes it returns.
+struct VramBudget
+{
+	uint64 budgetBytes = 0;
+	// A texture has to go unused for this many frames before it can lose levels. Every change reloads the texture
+	// on the render thread, so a working set that doesn't fit stays over budget instead of thrashing.
+	uint64 minIdleFrames = 60;
+	uint64 totalBytes = 0;
+	std::array<uint64, (size_t)ResourceCategory::Count> bytesPerCategory = {};
+
+	robin_hood::unordered_map<uint32, TrackedTexture> textures;
+	robin_hood::unordered_map<uint32, TrackedBuffer> buffers;
+
+	void AddTexture(const TrackedTexture& texture);
+	void RemoveTexture(uint32 textureId);
+	void AddBuffer(const TrackedBuffer& buffer);
+	void RemoveBuffer(uint32 bufferId);
+
+	void MarkUsed(uint32 textureId, uint64 frame);
+
+	// Restores levels of textures used this frame while they fit, counting only what can be taken from idle textures, then
+	// drops levels of the least recently used idle textures until we are back under budget. Textures used within the last
+	// minIdleFrames frames are never dropped.
+	void Update(uint64 frame, std::vector<ResidencyChange>& changes);
+
+	// Bytes of the levels [baseLevel, numLevels) of a mip chain
+	static uint64 MipChainSize(uint32 width, uint32 height, uint32 bytesPerPixel, int baseLevel, int numLevels);
+	static int NumMipLevels(uint32 width, uint32 height);
+	static uint64 ResidentSize(const TrackedTexture& texture);
+	static const char* toString(ResourceCategory category);
+
+private:
+	bool IsIdle(const TrackedTexture& texture, uint64 frame) const;
+	void SetBaseLevel(TrackedTexture& texture, int newBaseLevel, std::vector<ResidencyChange>& changes);
+};
@@ -0,0 +1,273 @@
+#include "include/ClusteredLighting.h"
+#include <chrono>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define CLUSTERED_LIGHTING_SSE 1
+#endif
+
+using Clock = std::chrono::high_resolution_clock;
+
+void ClusteredLighting::Init(ThreadPool* threadPool, const glm::ivec3& gridSize)
+{
+	this->threadPool = threadPool;
+	this->gridSize = gridSize;
+	clusterLights.resize(gridSize.x * gridSize.y * gridSize.z);
+	clusterRanges.resize(clusterLights.size());
+
+	glGenBuffers(1, &lightBuffer);
+	glGenBuffers(1, &clusterBuffer);
+	glGenBuffers(1, &lightIndexBuffer);
+}
+
+void ClusteredLighting::Destroy()
+{
+	glDeleteBuffers(1, &lightBuffer);
+	glDeleteBuffers(1, &clusterBuffer);
+	glDeleteBuffers(1, &lightIndexBuffer);
+	lightBufferSize = clusterBufferSize = lightIndexBufferSize = 0;
+	clusterLights.clear();
+	clusterRanges.clear();
+	lightIndices.clear();
+	gpuLights.clear();
+}
+
+void ClusteredLighting::SetProjection(const glm::mat4& projection, float nearPlane, float farPlane, const glm::vec2& screenSize)
+{
+	this->nearPlane = nearPlane;
+	this->farPlane = farPlane;
+	this->screenSize = screenSize;
+
+	// Exponential slices keep clusters roughly cubic along the depth
+	sliceDepths.resize(gridSize.z + 1);
+	for (int slice = 0; slice <= gridSize.z; slice++)
+	{
+		sliceDepths[slice] = nearPlane * glm::pow(farPlane / nearPlane, (float)slice / gridSize.z);
+	}
+
+	// Every tile corner becomes a view-space ray through the near plane, the cluster bounds are where those rays
+	// cross the near and far depth of the slice
+	const glm::mat4 inverseProjection = glm::inverse(projection);
+	std::vector<glm::vec3> cornerRays((gridSize.x + 1) * (gridSize.y + 1));
+	for (int y = 0; y <= gridSize.y; y++)
+	{
+		for (int x = 0; x <= gridSize.x; x++)
+		{
+			glm::vec4 ndc(2.0f * x / gridSize.x - 1.0f, 2.0f * y / gridSize.y - 1.0f, -1.0f, 1.0f);
+			glm::vec4 view = inverseProjection * ndc;
+			glm::vec3 point = glm::vec3(view) / view.w;
+			cornerRays[y * (gridSize.x + 1) + x] = point / -point.z; // Scaled to a view depth of 1
+		}
+	}
+
+	const int clustersPerSlice = gridSize.x * gridSize.y;
+	const int paddedClusters = (clustersPerSlice + 3) & ~3;
+	sliceBounds.resize(gridSize.z);
+	for (int slice = 0; slice < gridSize.z; slice++)
+	{
+		ClusterBounds& bounds = sliceBounds[slice];
+		// Padding clusters are empty boxes far away, nothing ever touches them
+		bounds.minX.assign(paddedClusters, FLT_MAX);
+		bounds.minY.assign(paddedClusters, FLT_MAX);
+		bounds.minZ.assign(paddedClusters, FLT_MAX);
+		bounds.maxX.assign(paddedClusters, FLT_MAX);
+		bounds.maxY.assign(paddedClusters, FLT_MAX);
+		bounds.maxZ.assign(paddedClusters, FLT_MAX);
+
+		for (int y = 0; y < gridSize.y; y++)
+		{
+			for (int x = 0; x < gridSize.x; x++)
+			{
+				glm::vec3 boxMin(FLT_MAX);
+				glm::vec3 boxMax(-FLT_MAX);
+				for (int corner = 0; corner < 8; corner++)
+				{
+					glm::vec3 ray = cornerRays[(y + ((corner >> 1) & 1)) * (gridSize.x + 1) + x + (corner & 1)];
+					glm::vec3 point = ray * sliceDepths[slice + (corner >> 2)];
+					boxMin = glm::min(boxMin, point);
+					boxMax = glm::max(boxMax, point);
+				}
+
+				const int cluster = y * gridSize.x + x;
+				bounds.minX[cluster] = boxMin.x;
+				bounds.minY[cluster] = boxMin.y;
+				bounds.minZ[cluster] = boxMin.z;
+				bounds.maxX[cluster] = boxMax.x;
+				bounds.maxY[cluster] = boxMax.y;
+				bounds.maxZ[cluster] = boxMax.z;
+			}
+		}
+	}
+}
+
+void ClusteredLighting::Bin(const glm::mat4& view)
+{
+	auto start = Clock::now();
+
+	// View-space bounding spheres, a spot light only needs the sphere around its cone
+	lightSpheres.resize(lights.size());
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		const Light& light = lights[i];
+		glm::vec3 center = light.position;
+		float radius = light.range;
+		if (light.type == LightType::Spot)
+		{
+			float cosAngle = glm::cos(light.outerAngle);
+			if (light.outerAngle > glm::quarter_pi<float>())
+			{
+				center = light.position + light.direction * (cosAngle * light.range);
+				radius = glm::sin(light.outerAngle) * light.range;
+			}
+			else
+			{
+				radius = light.range / (2.0f * cosAngle);
+				center = light.position + light.direction * radius;
+			}
+		}
+		lightSpheres[i] = { glm::vec3(view * glm::vec4(center, 1.0f)), radius };
+	}
+
+	threadPool->ParallelFor(gridSize.z, [this](int slice) { BinSlice(slice); });
+
+	// Flatten the per-cluster lists, clusters are ordered x, then y, then slice like in the shader
+	uint32 offset = 0;
+	for (size_t cluster = 0; cluster < clusterLights.size(); cluster++)
+	{
+		clusterRanges[cluster] = glm::uvec2(offset, (uint32)clusterLights[cluster].size());
+		offset += (uint32)clusterLights[cluster].size();
+	}
+	numLightIndices = offset;
+	lightIndices.resize(glm::max(offset, 1u));
+	threadPool->ParallelFor(gridSize.z, [this](int slice)
+	{
+		const int clustersPerSlice = gridSize.x * gridSize.y;
+		for (int cluster = slice * clustersPerSlice; cluster < (slice + 1) * clustersPerSlice; cluster++)
+		{
+			std::copy(clusterLights[cluster].begin(), clusterLights[cluster].end(), lightIndices.begin() + clusterRanges[cluster].x);
+		}
+	});
+
+	lastBinningMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void ClusteredLighting::Upload()
+{
+	auto start = Clock::now();
+
+	gpuLights.resize(glm::max(lights.size(), (size_t)1));
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		const Light& light = lights[i];
+		GpuLight& gpuLight = gpuLights[i];
+		gpuLight.positionRange = glm::vec4(light.position, light.range);
+		gpuLight.colorIntensity = glm::vec4(light.color, light.intensity);
+		if (light.type == LightType::Spot)
+		{
+			gpuLight.directionCosOuter = glm::vec4(glm::normalize(light.direction), glm::cos(light.outerAngle));
+			gpuLight.cosInner = glm::vec4(glm::cos(light.innerAngle));
+		}
+		else
+		{
+			gpuLight.directionCosOuter = glm::vec4(0.0f, -1.0f, 0.0f, -2.0f);
+			gpuLight.cosInner = glm::vec4(-1.0f);
+		}
+	}
+
+	UploadToBuffer(lightBuffer, lightBufferSize, gpuLights.data(), gpuLights.size() * sizeof(GpuLight));
+	UploadToBuffer(clusterBuffer, clusterBufferSize, clusterRanges.data(), clusterRanges.size() * sizeof(glm::uvec2));
+	UploadToBuffer(lightIndexBuffer, lightIndexBufferSize, lightIndices.data(), lightIndices.size() * sizeof(uint32));
+
+	lastUploadMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void ClusteredLighting::Bind(const ShaderProgram& program) const
+{
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, lightBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, clusterBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, lightIndexBuffer);
+
+	program.UploadIVec3("u_cluster_grid", gridSize);
+	program.UploadVec2("u_screen_size", screenSize);
+	program.UploadFloat("u_near_plane", nearPlane);
+	program.UploadFloat("u_far_plane", farPlane);
+}
+
+// Private functions
+void ClusteredLighting::BinSlice(int slice)
+{
+	const int clustersPerSlice = gridSize.x * gridSize.y;
+	std::vector<uint32>* sliceLights = &clusterLights[slice * clustersPerSlice];
+	for (int cluster = 0; cluster < clustersPerSlice; cluster++)
+	{
+		sliceLights[cluster].clear();
+	}
+
+	const ClusterBounds& bounds = sliceBounds[slice];
+	const int paddedClusters = (int)bounds.minX.size();
+	const float sliceNear = sliceDepths[slice];
+	const float sliceFar = sliceDepths[slice + 1];
+
+	for (uint32 lightIndex = 0; lightIndex < (uint32)lightSpheres.size(); lightIndex++)
+	{
+		const BoundingSphere& sphere = lightSpheres[lightIndex];
+		const float depth = -sphere.center.z;
+		if (depth + sphere.radius < sliceNear || depth - sphere.radius > sliceFar)
+		{
+			continue;
+		}
+
+		const float radiusSquared = sphere.radius * sphere.radius;
+#ifdef CLUSTERED_LIGHTING_SSE
+		// Squared distance from the sphere center to each box, 4 boxes at a time
+		const __m128 centerX = _mm_set1_ps(sphere.center.x);
+		const __m128 centerY = _mm_set1_ps(sphere.center.y);
+		const __m128 centerZ = _mm_set1_ps(sphere.center.z);
+		const __m128 radius2 = _mm_set1_ps(radiusSquared);
+		const __m128 zero = _mm_setzero_ps();
+		for (int cluster = 0; cluster < paddedClusters; cluster += 4)
+		{
+			__m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&bounds.minX[cluster]), centerX), _mm_sub_ps(centerX, _mm_loadu_ps(&bounds.maxX[cluster]))), zero);
+			__m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&bounds.minY[cluster]), centerY), _mm_sub_ps(centerY, _mm_loadu_ps(&bounds.maxY[cluster]))), zero);
+			__m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&bounds.minZ[cluster]), centerZ), _mm_sub_ps(centerZ, _mm_loadu_ps(&bounds.maxZ[cluster]))), zero);
+			__m128 distance2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+			int mask = _mm_movemask_ps(_mm_cmple_ps(distance2, radius2));
+			while (mask != 0)
+			{
+				int lane = 0;
+				while (!(mask & (1 << lane)))
+				{
+					lane++;
+				}
+				mask &= ~(1 << lane);
+				sliceLights[cluster + lane].push_back(lightIndex);
+			}
+		}
+#else
+		for (int cluster = 0; cluster < clustersPerSlice; cluster++)
+		{
+			glm::vec3 boxMin(bounds.minX[cluster], bounds.minY[cluster], bounds.minZ[cluster]);
+			glm::vec3 boxMax(bounds.maxX[cluster], bounds.maxY[cluster], bounds.maxZ[cluster]);
+			glm::vec3 delta = glm::max(glm::max(boxMin - sphere.center, sphere.center - boxMax), glm::vec3(0.0f));
+			if (glm::dot(delta, delta) <= radiusSquared)
+			{
+				sliceLights[cluster].push_back(lightIndex);
+			}
+		}
+#endif
+	}
+}
+
+void ClusteredLighting::UploadToBuffer(uint32 buffer, uint64& capacity, const void* data, uint64 size)
+{
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+	if (size > capacity || capacity == 0)
+	{
+		// Grow with some headroom so a few more lights don't reallocate every frame, never bind an empty buffer
+		capacity = glm::max(size + size / 2, (uint64)64);
+	}
+	// Orphan the old storage so we never wait for the draws of the previous frame to finish reading it
+	glBufferData(GL_SHADER_STORAGE_BUFFER, capacity, nullptr, GL_DYNAMIC_DRAW);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, size, data);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
@@ -0,0 +1,37 @@
+#include "include/ComputeProgram.h"
+
+bool ComputeProgram::Compile(const char* computeShaderFile)
+{
+	const ShaderStageFile stage = { ShaderType::Compute, computeShaderFile };
+	if (!CompileAndLink(&stage, 1))
+	{
+		workGroupSize = glm::ivec3(0);
+		return false;
+	}
+
+	glGetProgramiv(programId, GL_COMPUTE_WORK_GROUP_SIZE, glm::value_ptr(workGroupSize));
+	return true;
+}
+
+void ComputeProgram::Dispatch(uint32 numGroupsX, uint32 numGroupsY, uint32 numGroupsZ, GLbitfield barriers) const
+{
+	glDispatchCompute(numGroupsX, numGroupsY, numGroupsZ);
+	if (barriers != 0)
+	{
+		Barrier(barriers);
+	}
+}
+
+void ComputeProgram::DispatchForSize(uint32 width, uint32 height, uint32 depth, GLbitfield barriers) const
+{
+	// Round up so partially covered groups still get dispatched
+	uint32 numGroupsX = (width + workGroupSize.x - 1) / workGroupSize.x;
+	uint32 numGroupsY = (height + workGroupSize.y - 1) / workGroupSize.y;
+	uint32 numGroupsZ = (depth + workGroupSize.z - 1) / workGroupSize.z;
+	Dispatch(numGroupsX, numGroupsY, numGroupsZ, barriers);
+}
+
+void ComputeProgram::Barrier(GLbitfield barriers)
+{
+	glMemoryBarrier(barriers);
+}
@@ -0,0 +1,260 @@
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb/stb_image_write.h>
+#include <chrono>
+#include "include/FrameCapture.h"
+
+bool FrameCapture::Init(int width, int height, int ringSize)
+{
+	this->width = width;
+	this->height = height;
+	this->ringSize = glm::clamp(ringSize, 1, kMaxRingSize);
+	nextSlot = 0;
+
+	// Persistent and coherent so the worker can read the pixels without the render thread mapping or copying anything
+	const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	const GLsizeiptr size = (GLsizeiptr)width * height * 4;
+	for (int i = 0; i < this->ringSize; i++)
+	{
+		Slot& slot = slots[i];
+		glGenBuffers(1, &slot.pbo);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+		glBufferStorage(GL_PIXEL_PACK_BUFFER, size, nullptr, flags);
+		slot.mapped = static_cast<uint8*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, flags));
+		slot.fence = nullptr;
+		slot.videoFile = nullptr;
+		slot.state = SlotState::Free;
+		if (slot.mapped == nullptr)
+		{
+			std::cerr << "Failed to map frame capture buffer\n";
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			this->ringSize = i + 1;
+			Destroy();
+			return false;
+		}
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	stopWorker = false;
+	worker = std::thread(&FrameCapture::WorkerLoop, this);
+	return true;
+}
+
+void FrameCapture::Destroy()
+{
+	StopRecording();
+	CollectFinished(true);
+
+	if (worker.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			stopWorker = true;
+		}
+		queueCondition.notify_one();
+		worker.join();
+	}
+
+	for (int i = 0; i < ringSize; i++)
+	{
+		Slot& slot = slots[i];
+		if (slot.mapped != nullptr)
+		{
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			slot.mapped = nullptr;
+		}
+		glDeleteBuffers(1, &slot.pbo);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	ringSize = 0;
+}
+
+bool FrameCapture::Resize(int width, int height)
+{
+	if (width == this->width && height == this->height && ringSize > 0)
+	{
+		return true;
+	}
+
+	if (IsRecording())
+	{
+		std::cout << "Framebuffer resized to " << width << "x" << height << ", recording stopped\n";
+	}
+	const int numSlots = ringSize > 0 ? ringSize : 3;
+	Destroy();
+	return Init(width, height, numSlots);
+}
+
+void FrameCapture::RequestScreenshot(const char* filepath)
+{
+	pendingScreenshotPath = filepath;
+}
+
+bool FrameCapture::StartRecording(const char* filepath)
+{
+	StopRecording();
+	videoFile = new std::ofstream(filepath, std::ios::out | std::ios::binary);
+	if (!*videoFile)
+	{
+		std::cerr << "Could not open file: " << filepath << '\n';
+		delete videoFile;
+		videoFile = nullptr;
+		return false;
+	}
+
+	printf("Recording %dx%d RGBA frames to %s\n", width, height, filepath);
+	return true;
+}
+
+void FrameCapture::StopRecording()
+{
+	if (videoFile == nullptr)
+	{
+		return;
+	}
+
+	// The worker closes the file after writing every frame queued before this
+	CollectFinished(true);
+	PushJob({ -1, videoFile });
+	videoFile = nullptr;
+}
+
+void FrameCapture::Capture()
+{
+	if (ringSize == 0)
+	{
+		return;
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	CollectFinished(false);
+
+	bool wantScreenshot = !pendingScreenshotPath.empty();
+	if (wantScreenshot || videoFile != nullptr)
+	{
+		Slot& slot = slots[nextSlot];
+		if (slot.state != SlotState::Free)
+		{
+			// The GPU or the encoder can't keep up, drop the frame rather than stall. A pending screenshot stays pending.
+			numFramesDropped++;
+		}
+		else
+		{
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+			glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			slot.screenshotPath = std::move(pendingScreenshotPath);
+			slot.videoFile = videoFile;
+			slot.state = SlotState::InFlight;
+			pendingScreenshotPath.clear();
+
+			nextSlot = (nextSlot + 1) % ringSize;
+			numFramesCaptured++;
+		}
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	lastCaptureMs = std::chrono::duration<double, std::milli>(end - start).count();
+	totalCaptureMs += lastCaptureMs;
+	maxCaptureMs = glm::max(maxCaptureMs, lastCaptureMs);
+	numCaptureCalls++;
+}
+
+void FrameCapture::PrintReport() const
+{
+	double averageMs = numCaptureCalls > 0 ? totalCaptureMs / numCaptureCalls : 0.0;
+	printf("Frame capture: %llu frames captured, %llu dropped, render thread cost avg %.3f ms, max %.3f ms, last %.3f ms\n",
+		(unsigned long long)numFramesCaptured, (unsigned long long)numFramesDropped, averageMs, maxCaptureMs, lastCaptureMs);
+}
+
+// Private functions
+void FrameCapture::CollectFinished(bool wait)
+{
+	// Oldest first so video frames reach the worker in order
+	for (int i = 0; i < ringSize; i++)
+	{
+		Slot& slot = slots[(nextSlot + i) % ringSize];
+		if (slot.state != SlotState::InFlight)
+		{
+			continue;
+		}
+
+		GLenum status = glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000 : 0);
+		if (status == GL_TIMEOUT_EXPIRED)
+		{
+			// Fences signal in order, nothing after this one is done either
+			if (!wait)
+			{
+				break;
+			}
+			std::cerr << "Timed out waiting for a frame capture\n";
+		}
+
+		glDeleteSync(slot.fence);
+		slot.fence = nullptr;
+		slot.state = SlotState::Encoding;
+		PushJob({ (int)(&slot - slots), nullptr });
+	}
+}
+
+void FrameCapture::PushJob(const EncodeJob& job)
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		encodeQueue.push_back(job);
+	}
+	queueCondition.notify_one();
+}
+
+void FrameCapture::WorkerLoop()
+{
+	// The pixel pack buffers are bottom row first
+	stbi_flip_vertically_on_write(1);
+	const size_t rowSize = (size_t)width * 4;
+
+	while (true)
+	{
+		EncodeJob job;
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			queueCondition.wait(lock, [this]() { return stopWorker || !encodeQueue.empty(); });
+			if (encodeQueue.empty())
+			{
+				return;
+			}
+			job = encodeQueue.front();
+			encodeQueue.pop_front();
+		}
+
+		if (job.closeFile != nullptr)
+		{
+			delete job.closeFile;
+			continue;
+		}
+
+		Slot& slot = slots[job.slot];
+		if (!slot.screenshotPath.empty())
+		{
+			if (stbi_write_png(slot.screenshotPath.c_str(), width, height, 4, slot.mapped, (int)rowSize))
+			{
+				printf("Saved screenshot %s\n", slot.screenshotPath.c_str());
+			}
+			else
+			{
+				std::cerr << "Failed to write screenshot: " << slot.screenshotPath << '\n';
+			}
+		}
+
+		if (slot.videoFile != nullptr)
+		{
+			for (int row = height - 1; row >= 0; row--)
+			{
+				slot.videoFile->write(reinterpret_cast<const char*>(slot.mapped + row * rowSize), rowSize);
+			}
+		}
+
+		slot.state = SlotState::Free;
+	}
+}
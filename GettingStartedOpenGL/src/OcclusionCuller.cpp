@@ -0,0 +1,431 @@
+#include "include/OcclusionCuller.h"
+#include <chrono>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define OCCLUSION_CULLER_SSE 1
+#endif
+
+using Clock = std::chrono::high_resolution_clock;
+
+static double millisecondsSince(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void OcclusionCuller::Init(int width, int height, ThreadPool* threadPool)
+{
+	this->width = (width + 3) & ~3;
+	this->height = height;
+	this->threadPool = threadPool;
+
+	minPyramid.clear();
+	maxPyramid.clear();
+	levelSizes.clear();
+	glm::ivec2 size(this->width, this->height);
+	while (true)
+	{
+		levelSizes.push_back(size);
+		minPyramid.emplace_back(size.x * size.y, 1.0f);
+		maxPyramid.emplace_back(size.x * size.y, 1.0f);
+		if (size.x == 1 && size.y == 1)
+		{
+			break;
+		}
+		size = glm::max((size + 1) / 2, glm::ivec2(1));
+	}
+}
+
+void OcclusionCuller::Destroy()
+{
+	minPyramid.clear();
+	maxPyramid.clear();
+	levelSizes.clear();
+	occluderVertices.clear();
+	occluderIndices.clear();
+	screenVertices.clear();
+}
+
+void OcclusionCuller::SetOccluders(const std::vector<glm::vec3>& vertices, const std::vector<uint32>& indices)
+{
+	occluderVertices = vertices;
+	occluderIndices = indices;
+	screenVertices.resize(vertices.size());
+}
+
+void OcclusionCuller::Update(const glm::mat4& viewProjection)
+{
+	this->viewProjection = viewProjection;
+	auto start = Clock::now();
+
+	// Transform every vertex once, the bands share them
+	for (size_t i = 0; i < occluderVertices.size(); i++)
+	{
+		glm::vec4 clip = viewProjection * glm::vec4(occluderVertices[i], 1.0f);
+		if (clip.w <= 1e-5f)
+		{
+			screenVertices[i] = glm::vec4(0.0f, 0.0f, 0.0f, -1.0f);
+			continue;
+		}
+		glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		screenVertices[i] = glm::vec4((ndc.x * 0.5f + 0.5f) * width, (ndc.y * 0.5f + 0.5f) * height, ndc.z * 0.5f + 0.5f, clip.w);
+	}
+
+	// A few bands per thread so uneven bands even out. Rounding the band height up can leave fewer bands than asked
+	// for, e.g. 144 rows in 32 bands of 5 only needs 29 of them.
+	const int bandHeight = (height + threadPool->NumThreads() * 4 - 1) / (threadPool->NumThreads() * 4);
+	const int numBands = (height + bandHeight - 1) / bandHeight;
+	threadPool->ParallelFor(numBands, [&](int band)
+	{
+		RasterizeBand(band * bandHeight, glm::min((band + 1) * bandHeight, height) - 1);
+	});
+	lastStats.rasterizeMs = millisecondsSince(start);
+
+	start = Clock::now();
+	BuildPyramid();
+	lastStats.pyramidMs = millisecondsSince(start);
+}
+
+void OcclusionCuller::Cull(const BoundingBox* bounds, int numObjects, std::vector<uint8>& visible)
+{
+	auto start = Clock::now();
+
+	visible.resize(numObjects);
+	std::atomic<int> numFrustumCulled = 0;
+	std::atomic<int> numOccluded = 0;
+
+	constexpr int kObjectsPerTask = 256;
+	const int topLevel = (int)levelSizes.size() - 1;
+	threadPool->ParallelFor((numObjects + kObjectsPerTask - 1) / kObjectsPerTask, [&](int task)
+	{
+		int taskFrustumCulled = 0;
+		int taskOccluded = 0;
+		const int end = glm::min((task + 1) * kObjectsPerTask, numObjects);
+		for (int i = task * kObjectsPerTask; i < end; i++)
+		{
+			ScreenRect rect;
+			ProjectResult result = Project(bounds[i], rect);
+			if (result == ProjectResult::OffScreen)
+			{
+				visible[i] = 0;
+				taskFrustumCulled++;
+			}
+			else if (result == ProjectResult::CrossesNearPlane)
+			{
+				visible[i] = 1;
+			}
+			else
+			{
+				visible[i] = IsRectVisible(topLevel, 0, 0, 0, 0, rect) ? 1 : 0;
+				taskOccluded += visible[i] ? 0 : 1;
+			}
+		}
+		numFrustumCulled += taskFrustumCulled;
+		numOccluded += taskOccluded;
+	});
+
+	lastStats.numObjects = numObjects;
+	lastStats.numFrustumCulled = numFrustumCulled;
+	lastStats.numOccluded = numOccluded;
+	lastStats.testMs = millisecondsSince(start);
+
+	totalStats.numObjects += lastStats.numObjects;
+	totalStats.numFrustumCulled += lastStats.numFrustumCulled;
+	totalStats.numOccluded += lastStats.numOccluded;
+	totalStats.rasterizeMs += lastStats.rasterizeMs;
+	totalStats.pyramidMs += lastStats.pyramidMs;
+	totalStats.testMs += lastStats.testMs;
+	numFrames++;
+}
+
+bool OcclusionCuller::IsVisible(const BoundingBox& bounds) const
+{
+	ScreenRect rect;
+	ProjectResult result = Project(bounds, rect);
+	if (result != ProjectResult::OnScreen)
+	{
+		return result == ProjectResult::CrossesNearPlane;
+	}
+	return IsRectVisible((int)levelSizes.size() - 1, 0, 0, 0, 0, rect);
+}
+
+bool OcclusionCuller::IsVisibleBruteForce(const BoundingBox& bounds) const
+{
+	ScreenRect rect;
+	ProjectResult result = Project(bounds, rect);
+	if (result != ProjectResult::OnScreen)
+	{
+		return result == ProjectResult::CrossesNearPlane;
+	}
+
+	const std::vector<float>& depth = minPyramid[0];
+	for (int y = rect.minY; y <= rect.maxY; y++)
+	{
+		for (int x = rect.minX; x <= rect.maxX; x++)
+		{
+			if (rect.minDepth <= depth[y * width + x])
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void OcclusionCuller::PrintReport() const
+{
+	if (numFrames == 0)
+	{
+		return;
+	}
+
+	double culledRatio = totalStats.numObjects > 0
+		? (double)(totalStats.numFrustumCulled + totalStats.numOccluded) / totalStats.numObjects : 0.0;
+	printf("Occlusion culling over %llu frames: %.1f%% culled (%.1f%% occluded, %.1f%% off screen), "
+		"avg %.3f ms raster, %.3f ms pyramid, %.3f ms test\n",
+		(unsigned long long)numFrames, culledRatio * 100.0,
+		totalStats.numObjects > 0 ? 100.0 * totalStats.numOccluded / totalStats.numObjects : 0.0,
+		totalStats.numObjects > 0 ? 100.0 * totalStats.numFrustumCulled / totalStats.numObjects : 0.0,
+		totalStats.rasterizeMs / numFrames, totalStats.pyramidMs / numFrames, totalStats.testMs / numFrames);
+}
+
+// Private functions
+void OcclusionCuller::RasterizeBand(int minY, int maxY)
+{
+	if (minY > maxY)
+	{
+		return;
+	}
+
+	float* depth = minPyramid[0].data();
+	std::fill(depth + minY * width, depth + (maxY + 1) * width, 1.0f);
+
+	for (size_t i = 0; i + 2 < occluderIndices.size(); i += 3)
+	{
+		glm::vec4 v0 = screenVertices[occluderIndices[i]];
+		glm::vec4 v1 = screenVertices[occluderIndices[i + 1]];
+		glm::vec4 v2 = screenVertices[occluderIndices[i + 2]];
+
+		// Dropping a triangle that crosses the near plane only makes us cull less
+		if (v0.w <= 0.0f || v1.w <= 0.0f || v2.w <= 0.0f)
+		{
+			continue;
+		}
+
+		// Occluders are two sided, flip clockwise triangles
+		float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+		if (area < 0.0f)
+		{
+			std::swap(v1, v2);
+			area = -area;
+		}
+		if (area < 1e-8f)
+		{
+			continue;
+		}
+
+		int bboxMinX = glm::max((int)std::floor(glm::min(v0.x, glm::min(v1.x, v2.x))), 0);
+		int bboxMaxX = glm::min((int)std::ceil(glm::max(v0.x, glm::max(v1.x, v2.x))), width - 1);
+		int bboxMinY = glm::max((int)std::floor(glm::min(v0.y, glm::min(v1.y, v2.y))), minY);
+		int bboxMaxY = glm::min((int)std::ceil(glm::max(v0.y, glm::max(v1.y, v2.y))), maxY);
+		if (bboxMinX > bboxMaxX || bboxMinY > bboxMaxY)
+		{
+			continue;
+		}
+		// Start on a 4 pixel boundary, pixels left of the box fail the edge tests anyway
+		bboxMinX &= ~3;
+
+		// Edge functions, e0 is opposite v0 and so on, all of them are >= 0 inside
+		const glm::vec3 edgeDx(v1.y - v2.y, v2.y - v0.y, v0.y - v1.y);
+		const glm::vec3 edgeDy(v2.x - v1.x, v0.x - v2.x, v1.x - v0.x);
+		const float startX = bboxMinX + 0.5f;
+
+		// Window-space z is linear in screen space. Coverage is tested at the pixel center but the depth written is the
+		// farthest the triangle's plane gets anywhere in the pixel, so sloped occluders never end up in front of themselves.
+		const glm::vec3 z = glm::vec3(v0.z, v1.z, v2.z) / area;
+		const float depthDx = glm::dot(edgeDx, z);
+		const float farthestInPixel = 0.5f * (std::abs(depthDx) + std::abs(glm::dot(edgeDy, z)));
+
+		for (int y = bboxMinY; y <= bboxMaxY; y++)
+		{
+			// Evaluated from scratch on every row instead of stepped, so the result doesn't depend on where a band starts
+			const float rowY = y + 0.5f;
+			const glm::vec3 edgeRow(
+				(v2.x - v1.x) * (rowY - v1.y) - (v2.y - v1.y) * (startX - v1.x),
+				(v0.x - v2.x) * (rowY - v2.y) - (v0.y - v2.y) * (startX - v2.x),
+				(v1.x - v0.x) * (rowY - v0.y) - (v1.y - v0.y) * (startX - v0.x));
+			const float depthRow = glm::dot(edgeRow, z) + farthestInPixel;
+			float* row = depth + y * width;
+#ifdef OCCLUSION_CULLER_SSE
+			const __m128 offsets = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+			__m128 e0 = _mm_add_ps(_mm_set1_ps(edgeRow.x), _mm_mul_ps(offsets, _mm_set1_ps(edgeDx.x)));
+			__m128 e1 = _mm_add_ps(_mm_set1_ps(edgeRow.y), _mm_mul_ps(offsets, _mm_set1_ps(edgeDx.y)));
+			__m128 e2 = _mm_add_ps(_mm_set1_ps(edgeRow.z), _mm_mul_ps(offsets, _mm_set1_ps(edgeDx.z)));
+			__m128 d = _mm_add_ps(_mm_set1_ps(depthRow), _mm_mul_ps(offsets, _mm_set1_ps(depthDx)));
+			const __m128 e0Step = _mm_set1_ps(edgeDx.x * 4.0f);
+			const __m128 e1Step = _mm_set1_ps(edgeDx.y * 4.0f);
+			const __m128 e2Step = _mm_set1_ps(edgeDx.z * 4.0f);
+			const __m128 dStep = _mm_set1_ps(depthDx * 4.0f);
+			const __m128 zero = _mm_setzero_ps();
+			for (int x = bboxMinX; x <= bboxMaxX; x += 4)
+			{
+				__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+				if (_mm_movemask_ps(inside) != 0)
+				{
+					__m128 old = _mm_loadu_ps(row + x);
+					__m128 nearest = _mm_min_ps(old, d);
+					_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, old)));
+				}
+				e0 = _mm_add_ps(e0, e0Step);
+				e1 = _mm_add_ps(e1, e1Step);
+				e2 = _mm_add_ps(e2, e2Step);
+				d = _mm_add_ps(d, dStep);
+			}
+#else
+			glm::vec3 edge = edgeRow;
+			float d = depthRow;
+			for (int x = bboxMinX; x <= bboxMaxX; x++)
+			{
+				if (edge.x >= 0.0f && edge.y >= 0.0f && edge.z >= 0.0f)
+				{
+					row[x] = glm::min(row[x], d);
+				}
+				edge += edgeDx;
+				d += depthDx;
+			}
+#endif
+		}
+	}
+}
+
+void OcclusionCuller::BuildPyramid()
+{
+	// Center sampled coverage reaches up to half a pixel past an occluder's silhouette. Every pixel takes the farthest depth
+	// of its 3x3 neighbourhood, which pulls the silhouettes back by a pixel, so a pixel that is partly uncovered reads as
+	// uncovered as long as the gap is at least a pixel wide. The rasterizer writes into the min level 0 and the max one
+	// holds the horizontal pass, both end up with the same buffer.
+	std::vector<float>& depth = minPyramid[0];
+	std::vector<float>& rows = maxPyramid[0];
+	for (int y = 0; y < height; y++)
+	{
+		const float* in = &depth[y * width];
+		float* out = &rows[y * width];
+		for (int x = 0; x < width; x++)
+		{
+			out[x] = glm::max(glm::max(in[glm::max(x - 1, 0)], in[x]), in[glm::min(x + 1, width - 1)]);
+		}
+	}
+	for (int y = 0; y < height; y++)
+	{
+		const float* above = &rows[glm::max(y - 1, 0) * width];
+		const float* center = &rows[y * width];
+		const float* below = &rows[glm::min(y + 1, height - 1) * width];
+		float* out = &depth[y * width];
+		for (int x = 0; x < width; x++)
+		{
+			out[x] = glm::max(glm::max(above[x], center[x]), below[x]);
+		}
+	}
+	maxPyramid[0] = minPyramid[0];
+
+	for (size_t level = 1; level < levelSizes.size(); level++)
+	{
+		const glm::ivec2 size = levelSizes[level];
+		const glm::ivec2 parentSize = levelSizes[level - 1];
+		const std::vector<float>& parentMin = minPyramid[level - 1];
+		const std::vector<float>& parentMax = maxPyramid[level - 1];
+		std::vector<float>& levelMin = minPyramid[level];
+		std::vector<float>& levelMax = maxPyramid[level];
+
+		for (int y = 0; y < size.y; y++)
+		{
+			const int y0 = y * 2;
+			const int y1 = glm::min(y0 + 1, parentSize.y - 1);
+			for (int x = 0; x < size.x; x++)
+			{
+				const int x0 = x * 2;
+				const int x1 = glm::min(x0 + 1, parentSize.x - 1);
+				levelMin[y * size.x + x] = glm::min(
+					glm::min(parentMin[y0 * parentSize.x + x0], parentMin[y0 * parentSize.x + x1]),
+					glm::min(parentMin[y1 * parentSize.x + x0], parentMin[y1 * parentSize.x + x1]));
+				levelMax[y * size.x + x] = glm::max(
+					glm::max(parentMax[y0 * parentSize.x + x0], parentMax[y0 * parentSize.x + x1]),
+					glm::max(parentMax[y1 * parentSize.x + x0], parentMax[y1 * parentSize.x + x1]));
+			}
+		}
+	}
+}
+
+OcclusionCuller::ProjectResult OcclusionCuller::Project(const BoundingBox& bounds, ScreenRect& rect) const
+{
+	glm::vec3 screenMin(FLT_MAX);
+	glm::vec3 screenMax(-FLT_MAX);
+	for (int corner = 0; corner < 8; corner++)
+	{
+		glm::vec4 position(
+			corner & 1 ? bounds.max.x : bounds.min.x,
+			corner & 2 ? bounds.max.y : bounds.min.y,
+			corner & 4 ? bounds.max.z : bounds.min.z,
+			1.0f);
+		glm::vec4 clip = viewProjection * position;
+		if (clip.w <= 1e-5f)
+		{
+			return ProjectResult::CrossesNearPlane;
+		}
+		glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		screenMin = glm::min(screenMin, ndc);
+		screenMax = glm::max(screenMax, ndc);
+	}
+
+	if (screenMax.x < -1.0f || screenMin.x > 1.0f || screenMax.y < -1.0f || screenMin.y > 1.0f || screenMin.z > 1.0f)
+	{
+		return ProjectResult::OffScreen;
+	}
+	if (screenMin.z < -1.0f)
+	{
+		return ProjectResult::CrossesNearPlane;
+	}
+
+	// Every pixel the rectangle touches, not only the ones whose center it covers
+	rect.minX = glm::clamp((int)std::floor((screenMin.x * 0.5f + 0.5f) * width), 0, width - 1);
+	rect.maxX = glm::clamp((int)std::floor((screenMax.x * 0.5f + 0.5f) * width), 0, width - 1);
+	rect.minY = glm::clamp((int)std::floor((screenMin.y * 0.5f + 0.5f) * height), 0, height - 1);
+	rect.maxY = glm::clamp((int)std::floor((screenMax.y * 0.5f + 0.5f) * height), 0, height - 1);
+	rect.minDepth = screenMin.z * 0.5f + 0.5f;
+	return ProjectResult::OnScreen;
+}
+
+bool OcclusionCuller::IsRectVisible(int level, int minX, int minY, int maxX, int maxY, const ScreenRect& rect) const
+{
+	// Only look at the texels of this level the rectangle actually overlaps
+	minX = glm::max(minX, rect.minX >> level);
+	minY = glm::max(minY, rect.minY >> level);
+	maxX = glm::min(maxX, rect.maxX >> level);
+	maxY = glm::min(maxY, rect.maxY >> level);
+
+	const glm::ivec2 size = levelSizes[level];
+	const std::vector<float>& levelMin = minPyramid[level];
+	const std::vector<float>& levelMax = maxPyramid[level];
+	for (int y = minY; y <= maxY; y++)
+	{
+		for (int x = minX; x <= maxX; x++)
+		{
+			const int index = y * size.x + x;
+			// Behind everything in this texel
+			if (rect.minDepth > levelMax[index])
+			{
+				continue;
+			}
+			// In front of something in this texel, or we are down to single pixels
+			if (rect.minDepth <= levelMin[index] || level == 0)
+			{
+				return true;
+			}
+			if (IsRectVisible(level - 1, x * 2, y * 2, x * 2 + 1, y * 2 + 1, rect))
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
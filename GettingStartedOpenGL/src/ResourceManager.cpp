@@ -0,0 +1,219 @@
+#define STB_IMAGE_RESIZE_IMPLEMENTATION
+#include <stb/stb_image_resize.h>
+#include <stb/stb_image.h>
+#include "include/ResourceManager.h"
+
+void ResourceManager::Init(uint64 budgetBytes)
+{
+	budget.budgetBytes = budgetBytes;
+	frameIndex = 0;
+}
+
+void ResourceManager::Destroy()
+{
+	for (auto& [textureId, source] : textureSources)
+	{
+		uint32 id = textureId;
+		glDeleteTextures(1, &id);
+	}
+	textureSources.clear();
+	budget.textures.clear();
+	budget.buffers.clear();
+	budget.totalBytes = 0;
+	budget.bytesPerCategory = {};
+}
+
+uint32 ResourceManager::LoadTexture2D(const char* filepath, GLenum internalFormat, bool evictable)
+{
+	TextureSource source = { filepath, internalFormat };
+
+	uint32 texture;
+	glGenTextures(1, &texture);
+	uint32 width, height;
+	if (!UploadFromSource(texture, source, 0, &width, &height))
+	{
+		glDeleteTextures(1, &texture);
+		return 0;
+	}
+
+	TrackedTexture tracked = {};
+	tracked.textureId = texture;
+	tracked.width = width;
+	tracked.height = height;
+	tracked.bytesPerPixel = BytesPerPixel(internalFormat);
+	tracked.numLevels = VramBudget::NumMipLevels(width, height);
+	tracked.residentBaseLevel = 0;
+	tracked.maxBaseLevel = 0;
+	if (evictable)
+	{
+		while ((glm::min(width, height) >> (tracked.maxBaseLevel + 1)) >= minResidentSize)
+		{
+			tracked.maxBaseLevel++;
+		}
+	}
+	tracked.lastUsedFrame = frameIndex;
+	tracked.category = ResourceCategory::Texture;
+	budget.AddTexture(tracked);
+
+	textureSources.emplace(texture, std::move(source));
+	return texture;
+}
+
+void ResourceManager::DestroyTexture(uint32 textureId)
+{
+	budget.RemoveTexture(textureId);
+	textureSources.erase(textureId);
+	glDeleteTextures(1, &textureId);
+}
+
+void ResourceManager::TrackTexture(uint32 textureId, uint32 width, uint32 height, GLenum internalFormat, int numLevels, ResourceCategory category)
+{
+	TrackedTexture tracked = {};
+	tracked.textureId = textureId;
+	tracked.width = width;
+	tracked.height = height;
+	tracked.bytesPerPixel = BytesPerPixel(internalFormat);
+	tracked.numLevels = numLevels;
+	tracked.residentBaseLevel = 0;
+	tracked.maxBaseLevel = 0;
+	tracked.lastUsedFrame = frameIndex;
+	tracked.category = category;
+	budget.AddTexture(tracked);
+}
+
+void ResourceManager::UntrackTexture(uint32 textureId)
+{
+	budget.RemoveTexture(textureId);
+}
+
+void ResourceManager::TrackBuffer(uint32 bufferId, uint64 size, ResourceCategory category)
+{
+	budget.AddBuffer({ bufferId, size, category });
+}
+
+void ResourceManager::UntrackBuffer(uint32 bufferId)
+{
+	budget.RemoveBuffer(bufferId);
+}
+
+void ResourceManager::BindTexture(uint32 textureId)
+{
+	budget.MarkUsed(textureId, frameIndex);
+	glBindTexture(GL_TEXTURE_2D, textureId);
+}
+
+void ResourceManager::EndFrame()
+{
+	pendingChanges.clear();
+	budget.Update(frameIndex, pendingChanges);
+
+	for (const ResidencyChange& change : pendingChanges)
+	{
+		auto iter = textureSources.find(change.textureId);
+		if (iter == textureSources.end())
+		{
+			continue;
+		}
+
+		uint32 width, height;
+		if (!UploadFromSource(change.textureId, iter->second, change.newBaseLevel, &width, &height))
+		{
+			std::cerr << "Failed to change residency of texture " << change.textureId << '\n';
+		}
+	}
+
+	frameIndex++;
+}
+
+void ResourceManager::PrintMemoryReport() const
+{
+	constexpr double kMegabyte = 1024.0 * 1024.0;
+
+	int numEvicted = 0;
+	for (const auto& [textureId, texture] : budget.textures)
+	{
+		if (texture.residentBaseLevel > 0)
+		{
+			numEvicted++;
+		}
+	}
+
+	printf("VRAM: %.2f / %.2f MB, %d of %d textures evicted\n", budget.totalBytes / kMegabyte, budget.budgetBytes / kMegabyte,
+		numEvicted, (int)budget.textures.size());
+	for (size_t i = 0; i < (size_t)ResourceCategory::Count; i++)
+	{
+		if (budget.bytesPerCategory[i] > 0)
+		{
+			printf("  %-14s %10.2f MB\n", VramBudget::toString((ResourceCategory)i), budget.bytesPerCategory[i] / kMegabyte);
+		}
+	}
+}
+
+uint32 ResourceManager::BytesPerPixel(GLenum internalFormat)
+{
+	// Three channel formats are counted at their padded RGBA size, that's how drivers store them
+	switch (internalFormat)
+	{
+	case GL_R8:
+		return 1;
+	case GL_RG8:
+	case GL_R16F:
+		return 2;
+	case GL_RGB8:
+	case GL_SRGB8:
+	case GL_RGBA8:
+	case GL_SRGB8_ALPHA8:
+	case GL_RG16F:
+	case GL_R32F:
+	case GL_DEPTH_COMPONENT24:
+	case GL_DEPTH24_STENCIL8:
+	case GL_DEPTH_COMPONENT32F:
+		return 4;
+	case GL_RGB16F:
+	case GL_RGBA16F:
+	case GL_RG32F:
+		return 8;
+	case GL_RGB32F:
+	case GL_RGBA32F:
+		return 16;
+	}
+	std::cerr << "Unknown internal format 0x" << std::hex << internalFormat << std::dec << ", assuming 4 bytes per pixel\n";
+	return 4;
+}
+
+// Private functions
+bool ResourceManager::UploadFromSource(uint32 textureId, const TextureSource& source, int baseLevel, uint32* outWidth, uint32* outHeight)
+{
+	int width, height, nrChannels;
+	uint8* data = stbi_load(source.filepath.c_str(), &width, &height, &nrChannels, 0);
+	if (!data)
+	{
+		std::cerr << "Failed to load texture: " << source.filepath << '\n';
+		return false;
+	}
+	*outWidth = width;
+	*outHeight = height;
+
+	// Reallocating at a smaller size is what actually gives the memory back, GL_TEXTURE_BASE_LEVEL alone keeps the levels allocated
+	int uploadWidth = glm::max(width >> baseLevel, 1);
+	int uploadHeight = glm::max(height >> baseLevel, 1);
+	uint8* uploadData = data;
+	std::vector<uint8> resized;
+	if (baseLevel > 0)
+	{
+		resized.resize((size_t)uploadWidth * uploadHeight * nrChannels);
+		stbir_resize_uint8(data, width, height, 0, resized.data(), uploadWidth, uploadHeight, 0, nrChannels);
+		uploadData = resized.data();
+	}
+
+	static constexpr GLenum kFormats[] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+	glBindTexture(GL_TEXTURE_2D, textureId);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, source.internalFormat, uploadWidth, uploadHeight, 0, kFormats[nrChannels - 1], GL_UNSIGNED_BYTE, uploadData);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	stbi_image_free(data);
+	return true;
+}
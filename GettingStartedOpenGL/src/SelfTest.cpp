@@ -0,0 +1,185 @@
+#include "include/SelfTest.h"
+#include "include/OcclusionCuller.h"
+#include "include/ThreadPool.h"
+#include "include/VramBudget.h"
+#include <algorithm>
+
+static int numFailedChecks = 0;
+
+static void check(bool condition, const std::string& what)
+{
+	if (!condition)
+	{
+		std::cerr << "Self test failed: " << what << '\n';
+		numFailedChecks++;
+	}
+}
+
+// The depth buffer has to come out the same however the rows get split into bands across the threads
+static void TestOcclusionBands()
+{
+	// A few screen-filling triangles at different depths and some small ones at random places
+	std::vector<glm::vec3> vertices;
+	std::vector<uint32> indices;
+	auto addTriangle = [&](const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+	{
+		uint32 base = (uint32)vertices.size();
+		vertices.insert(vertices.end(), { a, b, c });
+		indices.insert(indices.end(), { base, base + 1, base + 2 });
+	};
+	addTriangle(glm::vec3(-3.0f, -3.0f, -0.5f), glm::vec3(3.0f, -3.0f, -0.5f), glm::vec3(0.0f, 3.0f, -0.5f));
+	addTriangle(glm::vec3(-1.0f, -1.0f, 0.2f), glm::vec3(1.0f, 1.0f, 0.4f), glm::vec3(-1.0f, 1.0f, 0.0f));
+	uint32 seed = 1;
+	auto random = [&seed]()
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) / 16777216.0f;
+	};
+	for (int i = 0; i < 64; i++)
+	{
+		glm::vec3 center(random() * 2.0f - 1.0f, random() * 2.0f - 1.0f, random() - 0.5f);
+		addTriangle(center, center + glm::vec3(0.2f, 0.05f, 0.1f), center + glm::vec3(0.05f, 0.3f, -0.1f));
+	}
+
+	// Orthographic view along -z so every triangle is in front of the camera
+	const glm::mat4 viewProjection = glm::ortho(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f);
+	for (int height : { 144, 100, 37, 7, 1 })
+	{
+		std::vector<float> reference;
+		for (int numThreads = 1; numThreads <= 16; numThreads++)
+		{
+			ThreadPool threadPool;
+			if (numThreads > 1)
+			{
+				threadPool.Init(numThreads - 1);
+			}
+
+			OcclusionCuller culler;
+			culler.Init(256, height, &threadPool);
+			culler.SetOccluders(vertices, indices);
+			// Rows no band clears would keep this
+			std::fill(culler.minPyramid[0].begin(), culler.minPyramid[0].end(), -1.0f);
+			const size_t depthSize = culler.minPyramid[0].size();
+			culler.Update(viewProjection);
+
+			const std::string name = std::to_string(culler.width) + "x" + std::to_string(height) + " depth buffer with "
+				+ std::to_string(numThreads) + " threads";
+			check(culler.minPyramid[0].size() == depthSize, name + " changed size");
+			check(std::none_of(culler.minPyramid[0].begin(), culler.minPyramid[0].end(), [](float depth) { return depth < 0.0f; }),
+				name + " has rows that were never rasterized");
+			if (numThreads == 1)
+			{
+				reference = culler.minPyramid[0];
+			}
+			else
+			{
+				check(culler.minPyramid[0] == reference, name + " differs from the single threaded one");
+			}
+
+			culler.Destroy();
+			threadPool.Destroy();
+		}
+	}
+}
+
+// Occluders may only hide what is behind them everywhere in a pixel, not just at its center
+static void TestOcclusionConservative()
+{
+	// Orthographic, x and y map straight to NDC and window depth is 0.5 - 0.5 * z
+	const glm::mat4 viewProjection = glm::ortho(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f);
+	ThreadPool threadPool;
+	OcclusionCuller culler;
+	culler.Init(16, 16, &threadPool);
+
+	// Column 8 spans x in [0, 0.125] with its center at 0.0625. The occluder ends at x = 0.08, so the center is covered
+	// but the right part of the pixel shows what is behind.
+	culler.SetOccluders({ glm::vec3(-3.0f, -3.0f, 0.0f), glm::vec3(0.08f, -3.0f, 0.0f), glm::vec3(0.08f, 3.0f, 0.0f) }, { 0, 1, 2 });
+	culler.Update(viewProjection);
+	check(culler.IsVisible({ glm::vec3(0.1f, 0.0f, -0.5f), glm::vec3(0.11f, 0.05f, -0.4f) }),
+		"object behind the uncovered part of a partly covered pixel was culled");
+	check(!culler.IsVisible({ glm::vec3(-0.5f, 0.0f, -0.5f), glm::vec3(-0.4f, 0.05f, -0.4f) }),
+		"object well inside the occluder's silhouette wasn't culled");
+
+	// A slope getting farther to the right, depth 0.5 + 2 * x. At the center of column 8 it is at 0.625 but at x = 0.11 it
+	// is at 0.72, an object at depth 0.68 there is in front of it.
+	culler.SetOccluders({ glm::vec3(-3.0f, -3.0f, 12.0f), glm::vec3(3.0f, -3.0f, -12.0f), glm::vec3(3.0f, 3.0f, -12.0f),
+		glm::vec3(-3.0f, 3.0f, 12.0f) }, { 0, 1, 2, 2, 3, 0 });
+	culler.Update(viewProjection);
+	check(culler.IsVisible({ glm::vec3(0.11f, 0.0f, -0.38f), glm::vec3(0.12f, 0.05f, -0.36f) }),
+		"object in front of a sloped occluder was culled");
+	check(!culler.IsVisible({ glm::vec3(-0.5f, 0.0f, 0.2f), glm::vec3(-0.4f, 0.05f, 0.1f) }),
+		"object behind a sloped occluder wasn't culled");
+
+	culler.Destroy();
+}
+
+// Two textures used on alternate frames must not evict each other every frame
+static void TestVramBudgetAlternatingUse()
+{
+	constexpr uint32 kTextureA = 1, kTextureB = 2;
+	VramBudget budget;
+	budget.budgetBytes = 6 * 1024 * 1024;
+	budget.minIdleFrames = 60;
+	for (uint32 textureId : { kTextureA, kTextureB })
+	{
+		TrackedTexture texture = {};
+		texture.textureId = textureId;
+		texture.width = 1024;
+		texture.height = 1024;
+		texture.bytesPerPixel = 4;
+		texture.numLevels = VramBudget::NumMipLevels(1024, 1024);
+		texture.maxBaseLevel = 4;
+		texture.category = ResourceCategory::Texture;
+		budget.AddTexture(texture);
+	}
+
+	std::vector<ResidencyChange> changes;
+	auto runFrames = [&](uint64 firstFrame, uint64 lastFrame, bool useB, std::vector<ResidencyChange>& allChanges)
+	{
+		for (uint64 frame = firstFrame; frame <= lastFrame; frame++)
+		{
+			budget.MarkUsed(frame % 2 == 0 || !useB ? kTextureA : kTextureB, frame);
+			changes.clear();
+			budget.Update(frame, changes);
+			allChanges.insert(allChanges.end(), changes.begin(), changes.end());
+		}
+	};
+
+	// Both are in use and together they don't fit, they stay resident over budget
+	std::vector<ResidencyChange> alternating;
+	runFrames(0, 199, true, alternating);
+	check(alternating.empty(), "alternating textures changed residency " + std::to_string(alternating.size()) + " times");
+
+	// B goes idle and gets evicted once, A is never touched
+	std::vector<ResidencyChange> idle;
+	runFrames(200, 299, false, idle);
+	check(idle.size() == 1 && idle[0].textureId == kTextureB && idle[0].newBaseLevel > idle[0].oldBaseLevel,
+		"idle texture wasn't evicted exactly once");
+	check(budget.totalBytes <= budget.budgetBytes, "still over budget with an idle texture left to evict");
+	check(budget.textures[kTextureA].residentBaseLevel == 0, "texture in use lost levels");
+
+	// Back to alternating, B gets back what fits next to A in one go and nothing gets evicted again
+	std::vector<ResidencyChange> resumed;
+	runFrames(300, 499, true, resumed);
+	check(resumed.size() <= 1, "resumed alternating use changed residency " + std::to_string(resumed.size()) + " times");
+	check(std::all_of(resumed.begin(), resumed.end(), [](const ResidencyChange& change) { return change.newBaseLevel < change.oldBaseLevel; }),
+		"texture in use was evicted");
+	check(budget.textures[kTextureA].residentBaseLevel == 0, "restoring one texture evicted the other");
+	check(budget.totalBytes <= budget.budgetBytes, "restore went over budget");
+}
+
+bool RunSelfTests()
+{
+	numFailedChecks = 0;
+	TestOcclusionBands();
+	TestOcclusionConservative();
+	TestVramBudgetAlternatingUse();
+
+	if (numFailedChecks > 0)
+	{
+		std::cerr << numFailedChecks << " self test checks failed\n";
+		return false;
+	}
+	std::cout << "All self tests passed\n";
+	return true;
+}
@@ -79,6 +79,14 @@ GLenum Shader::toGlShaderType(ShaderType type)
 		return GL_VERTEX_SHADER;
 	case ShaderType::Fragment:
 		return GL_FRAGMENT_SHADER;
+	case ShaderType::TessControl:
+		return GL_TESS_CONTROL_SHADER;
+	case ShaderType::TessEvaluation:
+		return GL_TESS_EVALUATION_SHADER;
+	case ShaderType::Geometry:
+		return GL_GEOMETRY_SHADER;
+	case ShaderType::Compute:
+		return GL_COMPUTE_SHADER;
 	}
 	return GL_INVALID_ENUM;
 }
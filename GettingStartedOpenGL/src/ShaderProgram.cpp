@@ -33,29 +33,55 @@ static GLint getVariableLocation(const ShaderProgram& shader, const char* varNam
 
 bool ShaderProgram::CompileAndLink(const char* vertexShaderFile, const char* fragmentShaderFile)
 {
-	// Create the shader program
-	GLuint program = glCreateProgram();
+	const ShaderStageFile stages[] = {
+		{ ShaderType::Vertex, vertexShaderFile },
+		{ ShaderType::Fragment, fragmentShaderFile },
+	};
+	return CompileAndLink(stages, 2);
+}
 
-	// Delete the shader if compilation fails( no sense to keep it )
-	Shader vertexShader;
-	if (!vertexShader.compile(ShaderType::Vertex, vertexShaderFile))
+bool ShaderProgram::CompileAndLink(const char* vertexShaderFile, const char* tessControlShaderFile, const char* tessEvaluationShaderFile,
+	const char* geometryShaderFile, const char* fragmentShaderFile)
+{
+	ShaderStageFile stages[5];
+	int numStages = 0;
+	stages[numStages++] = { ShaderType::Vertex, vertexShaderFile };
+	stages[numStages++] = { ShaderType::TessControl, tessControlShaderFile };
+	stages[numStages++] = { ShaderType::TessEvaluation, tessEvaluationShaderFile };
+	if (geometryShaderFile != nullptr)
 	{
-		vertexShader.destroy();
-		std::cerr << ("Failed to compile vertex shader.");
-		return false;
+		stages[numStages++] = { ShaderType::Geometry, geometryShaderFile };
 	}
+	stages[numStages++] = { ShaderType::Fragment, fragmentShaderFile };
+	return CompileAndLink(stages, numStages);
+}
 
-	Shader fragmentShader;
-	if (!fragmentShader.compile(ShaderType::Fragment, fragmentShaderFile))
+bool ShaderProgram::CompileAndLink(const ShaderStageFile* stages, int numStages)
+{
+	// Compile every stage first, delete the ones we already compiled if any of them fails( no sense to keep them )
+	std::vector<Shader> shaders(numStages);
+	for (int i = 0; i < numStages; i++)
 	{
-		fragmentShader.destroy();
-		std::cerr << ("Failed to compile fragment shader.");
-		return false;
+		if (!shaders[i].compile(stages[i].type, stages[i].filepath))
+		{
+			for (int j = 0; j < i; j++)
+			{
+				shaders[j].destroy();
+			}
+			std::cerr << "Failed to compile shader: " << stages[i].filepath << '\n';
+			programId = UINT32_MAX;
+			return false;
+		}
 	}
 
-	// Attach the vertex/fragment shaders and try to link them together
-	glAttachShader(program, vertexShader.shaderId);
-	glAttachShader(program, fragmentShader.shaderId);
+	// Create the shader program
+	GLuint program = glCreateProgram();
+
+	// Attach all the stages and try to link them together
+	for (const Shader& shader : shaders)
+	{
+		glAttachShader(program, shader.shaderId);
+	}
 
 	// Try to link our program
 	glLinkProgram(program);
@@ -74,8 +100,10 @@ bool ShaderProgram::CompileAndLink(const char* vertexShaderFile, const char* fra
 
 		// We don't need the program anymore if linking failed
 		glDeleteProgram(program);
-		vertexShader.destroy();
-		fragmentShader.destroy();
+		for (Shader& shader : shaders)
+		{
+			shader.destroy();
+		}
 
 		printf("Shader linking failed:\n%s", infoLog.data());
 		programId = UINT32_MAX;
@@ -83,10 +111,11 @@ bool ShaderProgram::CompileAndLink(const char* vertexShaderFile, const char* fra
 	}
 
 	// Always detach shaders after a successful link and destroy them since we don't need them anymore
-	glDetachShader(program, vertexShader.shaderId);
-	glDetachShader(program, fragmentShader.shaderId);
-	vertexShader.destroy();
-	fragmentShader.destroy();
+	for (Shader& shader : shaders)
+	{
+		glDetachShader(program, shader.shaderId);
+		shader.destroy();
+	}
 
 	// If linking succeeded, get all the active uniforms and store them in our map of uniform variable locations
 	int numUniforms;
@@ -115,7 +144,12 @@ bool ShaderProgram::CompileAndLink(const char* vertexShaderFile, const char* fra
 	}
 
 	programId = program;
-	printf("Shader compilation and linking succeeded <Vertex:%s>:<Fragment:%s>", vertexShaderFile, fragmentShaderFile);
+	printf("Shader compilation and linking succeeded");
+	for (int i = 0; i < numStages; i++)
+	{
+		printf(" <%s>", stages[i].filepath);
+	}
+	printf("\n");
 	return true;
 }
 
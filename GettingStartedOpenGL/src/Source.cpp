@@ -3,13 +3,25 @@
 #include "include/Core.h"
 #include "include/Shader.h"
 #include "include/ShaderProgram.h"
+#include "include/Terrain.h"
+#include "include/ResourceManager.h"
+#include "include/FrameCapture.h"
+#include "include/ThreadPool.h"
+#include "include/OcclusionCuller.h"
+#include "include/ClusteredLighting.h"
+#include "include/SelfTest.h"
+#include <random>
 
 void FramebufferSizeCallback(GLFWwindow* window, int width, int height);
 void MouseCallback(GLFWwindow* window, double xpos, double ypos);
 void ScrollCallback(GLFWwindow* window, double xoffset, double yoffset);
+void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
 
 void ProcessInput(GLFWwindow* window);
 void PrintMaximumVertexAttributes();
+int RunTerrain(GLFWwindow* window, int maxFrames, bool occlusionCulling, bool validateOcclusion, int numLights, bool lightBenchmark);
+void ScatterLights(const Terrain& terrain, int count, std::vector<Light>& lights);
+void BenchmarkLighting(GLFWwindow* window, const Terrain& terrain, ClusteredLighting& lighting, const glm::mat4& projection);
 
 // settings
 constexpr uint16 kScreenWidth = 1280;
@@ -31,20 +43,83 @@ float fov = 45.0f;
 float deltaTime = 0.0f;	// time between current frame and last frame
 float lastFrame = 0.0f;
 
+// gpu memory, press M for a report
+ResourceManager resources;
+
+// F12 takes a screenshot, F10 starts/stops recording
+FrameCapture frameCapture;
+int numScreenshots = 0;
+
+// cpu workers for per-frame jobs like occlusion culling
+ThreadPool threadPool;
+
 struct Vertex
 {
     glm::vec3 pos_coord;
     glm::vec2 tex_coord;
 };
 
-int main()
+int main(int argc, char** argv)
 {
+    // Command line
+    // --terrain     render the compute baked, tessellated terrain instead of the textured quad
+    // --hidden      don't show the window (e.g. on Mesa llvmpipe under xvfb)
+    // --frames <n>  exit after n frames
+    // --vram-budget <MB>  textures get evicted above this
+    // --record <file>      record raw RGBA frames from the start
+    // --screenshot <file>  take a screenshot of the first frame
+    // --no-occlusion       don't cull terrain patches hidden behind hills
+    // --validate-occlusion check every culling result against a brute-force depth comparison and the culled
+    //                      patches against the full resolution depth buffer
+    // --lights <n>         scatter n point and spot lights over the terrain
+    // --light-benchmark    time light binning and shading for a range of light counts, then exit
+    // --self-test          run the checks that don't need a window and exit
+    // ----------------------------------------------------------------------------------
+    bool terrainMode = false;
+    bool hidden = false;
+    int maxFrames = -1;
+    uint64 vramBudgetMB = 512;
+    const char* recordFile = nullptr;
+    const char* screenshotFile = nullptr;
+    bool occlusionCulling = true;
+    bool validateOcclusion = false;
+    int numLights = 256;
+    bool lightBenchmark = false;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string_view arg = argv[i];
+        if (arg == "--terrain")
+            terrainMode = true;
+        else if (arg == "--hidden")
+            hidden = true;
+        else if (arg == "--frames" && i + 1 < argc)
+            maxFrames = std::atoi(argv[++i]);
+        else if (arg == "--vram-budget" && i + 1 < argc)
+            vramBudgetMB = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--record" && i + 1 < argc)
+            recordFile = argv[++i];
+        else if (arg == "--no-occlusion")
+            occlusionCulling = false;
+        else if (arg == "--validate-occlusion")
+            validateOcclusion = true;
+        else if (arg == "--screenshot" && i + 1 < argc)
+            screenshotFile = argv[++i];
+        else if (arg == "--lights" && i + 1 < argc)
+            numLights = std::atoi(argv[++i]);
+        else if (arg == "--light-benchmark")
+            lightBenchmark = true;
+        else if (arg == "--self-test")
+            return RunSelfTests() ? 0 : -1;
+    }
+
     // Initialization
     // ----------------------------------------------------------------------------------
     glfwInit();  
+    // The terrain shaders only need 4.5, which is the highest llvmpipe exposes
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, terrainMode ? 5 : 6);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, hidden ? GLFW_FALSE : GLFW_TRUE);
 
     GLFWwindow* window = glfwCreateWindow(
         kScreenHeight, // Window Width
@@ -63,6 +138,7 @@ int main()
     glfwMakeContextCurrent(window);
     glfwSetFramebufferSizeCallback(window, FramebufferSizeCallback);
     glfwSetCursorPosCallback(window, MouseCallback);
+    glfwSetKeyCallback(window, KeyCallback);
     // glfwSetScrollCallback(window, ScrollCallback);
 
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -74,10 +150,36 @@ int main()
     }
     // ----------------------------------------------------------------------------------
 
+    resources.Init(vramBudgetMB * 1024 * 1024);
+    threadPool.Init();
+
+    int framebufferWidth, framebufferHeight;
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    if (frameCapture.Init(framebufferWidth, framebufferHeight))
+    {
+        for (int i = 0; i < frameCapture.ringSize; i++)
+            resources.TrackBuffer(frameCapture.slots[i].pbo, (uint64)framebufferWidth * framebufferHeight * 4, ResourceCategory::PixelBuffer);
+        if (recordFile != nullptr)
+            frameCapture.StartRecording(recordFile);
+        if (screenshotFile != nullptr)
+            frameCapture.RequestScreenshot(screenshotFile);
+    }
+
     // configure global OpenGl state
     // -----------------------------
     glEnable(GL_DEPTH_TEST);
 
+    if (terrainMode)
+    {
+        int result = RunTerrain(window, maxFrames, occlusionCulling, validateOcclusion, numLights, lightBenchmark);
+        frameCapture.PrintReport();
+        frameCapture.Destroy();
+        resources.Destroy();
+        threadPool.Destroy();
+        glfwTerminate();
+        return result;
+    }
+
     ShaderProgram shader;
 	shader.CompileAndLink("assets/shaders/basic.vs", "assets/shaders/basic.fs");
 
@@ -164,17 +266,25 @@ int main()
     // bind VBO
     glBindBuffer(GL_ARRAY_BUFFER, myVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(rectangle), rectangle.data(), GL_STATIC_DRAW);
+    resources.TrackBuffer(myVBO, sizeof(rectangle), ResourceCategory::VertexBuffer);
 
     // bind EBO
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, myEBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices_of_rectangle), indices_of_rectangle.data(), GL_STATIC_DRAW);
+    resources.TrackBuffer(myEBO, sizeof(indices_of_rectangle), ResourceCategory::IndexBuffer);
 
     // Uncomment the following to enable frame mode;
     // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
 
-    uint32 texture;
-    glGenTextures(1, &texture);
+    // Set to flip the y-axis so that the image isn't upside-down
+	stbi_set_flip_vertically_on_load(true);
+    // load and generate the texture, the resource manager keeps the file around to reload it after an eviction
+    uint32 texture = resources.LoadTexture2D("assets/textures/Kurisu.jpg", GL_RGB32F);
+    if (texture == 0)
+    {
+        std::cerr << "Failed to load texture\n";
+    }
     glBindTexture(GL_TEXTURE_2D, texture);
     // set the texture wrapping/filtering options (on the currently bound texture object)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -182,22 +292,6 @@ int main()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    // Set to flip the y-axis so that the image isn't upside-down
-	stbi_set_flip_vertically_on_load(true);
-    // load and generate the texture
-    int width, height, nrChannels;
-    uint8 *data = stbi_load("assets/textures/Kurisu.jpg", &width, &height, &nrChannels, 0);
-    if (data)
-    {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    }
-    else
-    {
-        std::cerr << "Failed to load texture\n";
-    }
-    stbi_image_free(data);
-
     // Configure vertex attributes
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, pos_coord));
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, tex_coord));
@@ -222,7 +316,8 @@ int main()
     glEnable(GL_DEPTH_TEST);
 
     // render Loop
-    while (!glfwWindowShouldClose(window)) // when the window is on, do the followings
+    int frameCount = 0;
+    while (!glfwWindowShouldClose(window) && frameCount++ != maxFrames) // when the window is on, do the followings
     {
 
         float currentFrame = static_cast<float>(glfwGetTime());
@@ -239,27 +334,281 @@ int main()
 
         shader.Bind();
         shader.UploadMat4("u_combo_mat", combo);
-        glBindTexture(GL_TEXTURE_2D, texture);
+        resources.BindTexture(texture);
         glBindVertexArray(myVAO);
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
     	glBindVertexArray(0);
         shader.Unbind();
 
+        resources.EndFrame();
+        frameCapture.Capture();
+
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
     // optional: de-allocate all resources once they've outlived their purpose:
     // ------------------------------------------------------------------------
+    resources.PrintMemoryReport();
+    frameCapture.PrintReport();
+    frameCapture.Destroy();
     glDeleteVertexArrays(1, &myVAO);
     glDeleteBuffers(1, &myVBO);
     glDeleteBuffers(1, &myEBO);
     glDeleteProgram(shader.programId);
+    resources.Destroy();
+    threadPool.Destroy();
 
     glfwTerminate();
     return 0;
 }
 
+int RunTerrain(GLFWwindow* window, int maxFrames, bool occlusionCulling, bool validateOcclusion, int numLights, bool lightBenchmark)
+{
+    Terrain terrain;
+    if (!terrain.Init(1024, 32, 64.0f))
+    {
+        std::cerr << "Failed to initialize terrain\n";
+        return -1;
+    }
+
+    resources.TrackTexture(terrain.heightmapTexture, terrain.heightmapResolution, terrain.heightmapResolution, GL_RGBA32F, 1, ResourceCategory::Texture);
+    resources.TrackBuffer(terrain.patchVBO, (uint64)terrain.patchesPerSide * terrain.patchesPerSide * 4 * sizeof(glm::vec3), ResourceCategory::VertexBuffer);
+
+    // Heights are baked once here instead of every vertex every frame
+    terrain.Bake(1.5f, 8.0f, glm::vec2(0.0f));
+    glm::vec2 heightRange = terrain.ReadHeightRange();
+    std::cout << "Terrain baked, heights in [" << heightRange.x << ", " << heightRange.y << "]\n";
+    if (!(heightRange.y > heightRange.x))
+    {
+        std::cerr << "Terrain bake produced a flat or invalid heightmap\n";
+        terrain.Destroy();
+        return -1;
+    }
+
+    cameraPos = glm::vec3(0.0f, 6.0f, 20.0f);
+    glClearColor(0.5f, 0.7f, 0.9f, 1.0f);
+
+    // The low-resolution depth buffer keeps the screen aspect ratio
+    OcclusionCuller occlusionCuller;
+    occlusionCuller.Init(256, 144, &threadPool);
+    occlusionCuller.SetOccluders(terrain.occluderVertices, terrain.occluderIndices);
+    std::vector<uint8> visiblePatches;
+    int numOcclusionMismatches = 0;
+    std::vector<uint8> culledPatches;
+    uint32 culledSamplesQuery = 0;
+    uint64 numCulledVisibleSamples = 0;
+    if (validateOcclusion)
+        glGenQueries(1, &culledSamplesQuery);
+
+    // The projection doesn't change so the cluster bounds are only rebuilt when the framebuffer gets resized
+    glm::mat4 projection = glm::perspective(glm::radians(fov), static_cast<float>(kScreenWidth) / kScreenHeight, 0.1f, 200.0f);
+    ClusteredLighting lighting;
+    lighting.Init(&threadPool);
+    // Fragments find their tile from gl_FragCoord, so the tiles have to cover the framebuffer
+    glm::ivec2 lightingScreenSize;
+    glfwGetFramebufferSize(window, &lightingScreenSize.x, &lightingScreenSize.y);
+    lighting.SetProjection(projection, 0.1f, 200.0f, glm::vec2(lightingScreenSize));
+    ScatterLights(terrain, numLights, lighting.lights);
+    if (lightBenchmark)
+    {
+        BenchmarkLighting(window, terrain, lighting, projection);
+        maxFrames = 0;
+    }
+    uint64 lightBufferSize = 0, clusterBufferSize = 0, lightIndexBufferSize = 0;
+
+    int frameCount = 0;
+    while (!glfwWindowShouldClose(window) && frameCount++ != maxFrames)
+    {
+        float currentFrame = static_cast<float>(glfwGetTime());
+        deltaTime = currentFrame - lastFrame;
+        lastFrame = currentFrame;
+
+        ProcessInput(window);
+
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
+        glm::mat4 viewProjection = projection * view;
+
+        glm::ivec2 framebufferSize;
+        glfwGetFramebufferSize(window, &framebufferSize.x, &framebufferSize.y);
+        if (framebufferSize != lightingScreenSize && framebufferSize.x > 0 && framebufferSize.y > 0)
+        {
+            lightingScreenSize = framebufferSize;
+            lighting.SetProjection(projection, 0.1f, 200.0f, glm::vec2(lightingScreenSize));
+        }
+        lighting.Bin(view);
+        lighting.Upload();
+        // The storage buffers only get re-tracked when they grow
+        if (lighting.lightBufferSize != lightBufferSize || lighting.clusterBufferSize != clusterBufferSize || lighting.lightIndexBufferSize != lightIndexBufferSize)
+        {
+            lightBufferSize = lighting.lightBufferSize;
+            clusterBufferSize = lighting.clusterBufferSize;
+            lightIndexBufferSize = lighting.lightIndexBufferSize;
+            resources.TrackBuffer(lighting.lightBuffer, lightBufferSize, ResourceCategory::StorageBuffer);
+            resources.TrackBuffer(lighting.clusterBuffer, clusterBufferSize, ResourceCategory::StorageBuffer);
+            resources.TrackBuffer(lighting.lightIndexBuffer, lightIndexBufferSize, ResourceCategory::StorageBuffer);
+        }
+
+        // The occluders only stand for the terrain when it is seen from above
+        const BoundingBox* groundBelow = terrain.PatchBoundsAt(cameraPos);
+        if (occlusionCulling && (groundBelow == nullptr || cameraPos.y > groundBelow->max.y))
+        {
+            occlusionCuller.Update(viewProjection);
+            occlusionCuller.Cull(terrain.patchBounds.data(), (int)terrain.patchBounds.size(), visiblePatches);
+            if (validateOcclusion)
+            {
+                for (size_t i = 0; i < terrain.patchBounds.size(); i++)
+                {
+                    if ((visiblePatches[i] != 0) != occlusionCuller.IsVisibleBruteForce(terrain.patchBounds[i]))
+                        numOcclusionMismatches++;
+                }
+            }
+            terrain.Draw(viewProjection, cameraPos, &visiblePatches, &lighting);
+            if (validateOcclusion)
+            {
+                // Any sample of a culled patch that passes the depth test of the real frame was visible
+                culledPatches.resize(visiblePatches.size());
+                for (size_t i = 0; i < visiblePatches.size(); i++)
+                    culledPatches[i] = visiblePatches[i] == 0;
+                glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+                glDepthMask(GL_FALSE);
+                glBeginQuery(GL_SAMPLES_PASSED, culledSamplesQuery);
+                terrain.Draw(viewProjection, cameraPos, &culledPatches);
+                glEndQuery(GL_SAMPLES_PASSED);
+                glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+                glDepthMask(GL_TRUE);
+                // Waits for the gpu, only done when validating
+                uint32 culledSamples = 0;
+                glGetQueryObjectuiv(culledSamplesQuery, GL_QUERY_RESULT, &culledSamples);
+                numCulledVisibleSamples += culledSamples;
+            }
+        }
+        else
+        {
+            terrain.Draw(viewProjection, cameraPos, nullptr, &lighting);
+        }
+        resources.EndFrame();
+        frameCapture.Capture();
+
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+    }
+
+    // Any error in the loop is a failure for headless runs
+    GLenum error = glGetError();
+    resources.PrintMemoryReport();
+    occlusionCuller.PrintReport();
+    occlusionCuller.Destroy();
+    if (validateOcclusion)
+        glDeleteQueries(1, &culledSamplesQuery);
+    resources.UntrackBuffer(lighting.lightBuffer);
+    resources.UntrackBuffer(lighting.clusterBuffer);
+    resources.UntrackBuffer(lighting.lightIndexBuffer);
+    lighting.Destroy();
+    resources.UntrackTexture(terrain.heightmapTexture);
+    resources.UntrackBuffer(terrain.patchVBO);
+    terrain.Destroy();
+    if (error != GL_NO_ERROR)
+    {
+        std::cerr << "GL error during terrain rendering: 0x" << std::hex << error << std::dec << '\n';
+        return -1;
+    }
+    if (numOcclusionMismatches > 0)
+    {
+        std::cerr << "Occlusion culling disagreed with the brute-force depth comparison " << numOcclusionMismatches << " times\n";
+        return -1;
+    }
+    if (numCulledVisibleSamples > 0)
+    {
+        std::cerr << "Culled terrain patches covered " << numCulledVisibleSamples << " visible samples at full resolution\n";
+        return -1;
+    }
+    return 0;
+}
+
+void ScatterLights(const Terrain& terrain, int count, std::vector<Light>& lights)
+{
+    // Fixed seed so benchmark runs are comparable
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    lights.clear();
+    lights.reserve(count);
+    for (int i = 0; i < count; i++)
+    {
+        Light light;
+        light.type = (i % 4 == 3) ? LightType::Spot : LightType::Point;
+        light.position.x = (unit(rng) - 0.5f) * terrain.worldSize;
+        light.position.z = (unit(rng) - 0.5f) * terrain.worldSize;
+        const BoundingBox* ground = terrain.PatchBoundsAt(light.position);
+        light.position.y = (ground != nullptr ? ground->max.y : 0.0f) + 0.5f + 2.5f * unit(rng);
+        light.range = 1.5f + 3.0f * unit(rng);
+        light.color = glm::vec3(0.3f) + 0.7f * glm::vec3(unit(rng), unit(rng), unit(rng));
+        light.intensity = 6.0f;
+        // Spot lights point down with a bit of tilt
+        light.direction = glm::normalize(glm::vec3(unit(rng) - 0.5f, -1.0f, unit(rng) - 0.5f));
+        light.innerAngle = glm::radians(15.0f);
+        light.outerAngle = glm::radians(30.0f);
+        lights.push_back(light);
+    }
+}
+
+void BenchmarkLighting(GLFWwindow* window, const Terrain& terrain, ClusteredLighting& lighting, const glm::mat4& projection)
+{
+    constexpr int kFramesPerCount = 30;
+    constexpr std::array<int, 6> kLightCounts = { 0, 64, 256, 1024, 4096, 16384 };
+
+    glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
+    glm::mat4 viewProjection = projection * view;
+    int numClusters = lighting.gridSize.x * lighting.gridSize.y * lighting.gridSize.z;
+
+    uint32 timerQuery;
+    glGenQueries(1, &timerQuery);
+
+    // Times one terrain draw on the gpu, the result is waited for so frames don't overlap
+    auto timeDraw = [&](const ClusteredLighting* drawLighting)
+    {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glBeginQuery(GL_TIME_ELAPSED, timerQuery);
+        terrain.Draw(viewProjection, cameraPos, nullptr, drawLighting);
+        glEndQuery(GL_TIME_ELAPSED);
+        uint64 nanoseconds = 0;
+        glGetQueryObjectui64v(timerQuery, GL_QUERY_RESULT, &nanoseconds);
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+        return nanoseconds / 1e6;
+    };
+
+    // Sun only, the cost every light count is compared against
+    double sunOnlyMs = 0.0;
+    for (int frame = 0; frame < kFramesPerCount; frame++)
+        sunOnlyMs += timeDraw(nullptr);
+    sunOnlyMs /= kFramesPerCount;
+
+    printf("Clustered lighting benchmark, %dx%dx%d clusters, %d threads\n", lighting.gridSize.x, lighting.gridSize.y, lighting.gridSize.z, threadPool.NumThreads());
+    printf("Sun only shading: %.3f ms\n", sunOnlyMs);
+    printf("%8s %12s %12s %14s %14s\n", "lights", "binning ms", "upload ms", "lights/cluster", "shading ms");
+    for (int count : kLightCounts)
+    {
+        ScatterLights(terrain, count, lighting.lights);
+        double binningMs = 0.0, uploadMs = 0.0, shadingMs = 0.0;
+        for (int frame = 0; frame < kFramesPerCount; frame++)
+        {
+            lighting.Bin(view);
+            lighting.Upload();
+            binningMs += lighting.lastBinningMs;
+            uploadMs += lighting.lastUploadMs;
+            shadingMs += timeDraw(&lighting);
+        }
+        printf("%8d %12.3f %12.3f %14.2f %14.3f\n", count, binningMs / kFramesPerCount, uploadMs / kFramesPerCount,
+            (double)lighting.numLightIndices / numClusters, shadingMs / kFramesPerCount);
+    }
+
+    glDeleteQueries(1, &timerQuery);
+}
+
 void ProcessInput(GLFWwindow* window)
 {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
@@ -276,9 +625,21 @@ void ProcessInput(GLFWwindow* window)
         cameraPos += glm::normalize(glm::cross(cameraFront, cameraUp)) * cameraSpeed;
 }
 
-void FramebufferSizeCallback(GLFWwindow* window, const int &width, const int &height)
+void FramebufferSizeCallback(GLFWwindow* window, int width, int height)
 {
     glViewport(0, 0, width, height);
+    // A minimized window reports 0x0, keep everything sized for the last real framebuffer
+    if (width == 0 || height == 0)
+        return;
+
+    // glReadPixels has to read the whole new framebuffer, not the old size
+    for (int i = 0; i < frameCapture.ringSize; i++)
+        resources.UntrackBuffer(frameCapture.slots[i].pbo);
+    if (frameCapture.Resize(width, height))
+    {
+        for (int i = 0; i < frameCapture.ringSize; i++)
+            resources.TrackBuffer(frameCapture.slots[i].pbo, (uint64)width * height * 4, ResourceCategory::PixelBuffer);
+    }
 }
 
 void MouseCallback(GLFWwindow* window, double xposIn, double yposIn)
@@ -318,6 +679,23 @@ void MouseCallback(GLFWwindow* window, double xposIn, double yposIn)
     cameraFront = glm::normalize(front);
 }
 
+void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+    if (key == GLFW_KEY_M && action == GLFW_PRESS)
+        resources.PrintMemoryReport();
+
+    if (key == GLFW_KEY_F12 && action == GLFW_PRESS)
+        frameCapture.RequestScreenshot(("screenshot_" + std::to_string(numScreenshots++) + ".png").c_str());
+
+    if (key == GLFW_KEY_F10 && action == GLFW_PRESS)
+    {
+        if (frameCapture.IsRecording())
+            frameCapture.StopRecording();
+        else
+            frameCapture.StartRecording("capture.raw");
+    }
+}
+
 void ScrollCallback(GLFWwindow* window, double xoffset, double yoffset)
 {
     fov -= (float)yoffset;
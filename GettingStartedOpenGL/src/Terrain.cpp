@@ -0,0 +1,268 @@
+#include "include/Terrain.h"
+
+bool Terrain::Init(int heightmapResolution, int patchesPerSide, float worldSize)
+{
+	this->heightmapResolution = heightmapResolution;
+	this->patchesPerSide = patchesPerSide;
+	this->worldSize = worldSize;
+
+	if (!bakeProgram.Compile("assets/shaders/perlinTerrain.cs"))
+	{
+		return false;
+	}
+
+	if (!drawProgram.CompileAndLink("assets/shaders/terrain.vs", "assets/shaders/terrain.tcs", "assets/shaders/terrain.tes",
+		nullptr, "assets/shaders/terrain.fs"))
+	{
+		bakeProgram.Destroy();
+		return false;
+	}
+
+	// Don't ask for more than the driver can generate
+	int maxTessGenLevel;
+	glGetIntegerv(GL_MAX_TESS_GEN_LEVEL, &maxTessGenLevel);
+	maxTessLevel = glm::min(maxTessLevel, static_cast<float>(maxTessGenLevel));
+
+	// Immutable storage so it can be bound as an image
+	glGenTextures(1, &heightmapTexture);
+	glBindTexture(GL_TEXTURE_2D, heightmapTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, heightmapResolution, heightmapResolution);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// One flat quad patch per grid cell, centered around the origin
+	std::vector<glm::vec3> patchCorners;
+	patchCorners.reserve(patchesPerSide * patchesPerSide * 4);
+	float patchSize = worldSize / patchesPerSide;
+	float halfSize = worldSize * 0.5f;
+	for (int z = 0; z < patchesPerSide; z++)
+	{
+		for (int x = 0; x < patchesPerSide; x++)
+		{
+			float x0 = x * patchSize - halfSize;
+			float z0 = z * patchSize - halfSize;
+			patchCorners.emplace_back(x0, 0.0f, z0);
+			patchCorners.emplace_back(x0 + patchSize, 0.0f, z0);
+			patchCorners.emplace_back(x0 + patchSize, 0.0f, z0 + patchSize);
+			patchCorners.emplace_back(x0, 0.0f, z0 + patchSize);
+		}
+	}
+
+	glGenVertexArrays(1, &patchVAO);
+	glGenBuffers(1, &patchVBO);
+	glBindVertexArray(patchVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, patchVBO);
+	glBufferData(GL_ARRAY_BUFFER, patchCorners.size() * sizeof(glm::vec3), patchCorners.data(), GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), nullptr);
+	glEnableVertexAttribArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+
+	return true;
+}
+
+void Terrain::Bake(float heightScale, float noiseScale, const glm::vec2& noiseOffset)
+{
+	bakeProgram.Bind();
+	bakeProgram.UploadFloat("u_world_size", worldSize);
+	bakeProgram.UploadFloat("u_height_scale", heightScale);
+	bakeProgram.UploadFloat("u_noise_scale", noiseScale);
+	bakeProgram.UploadVec2("u_noise_offset", noiseOffset);
+	glBindImageTexture(0, heightmapTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+
+	// The tessellation stages sample the result and ReadHeightRange reads it back
+	bakeProgram.DispatchForSize(heightmapResolution, heightmapResolution, 1,
+		GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+	glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+	bakeProgram.Unbind();
+
+	BuildCullingData();
+}
+
+void Terrain::Draw(const glm::mat4& viewProjection, const glm::vec3& cameraPos, const std::vector<uint8>* visiblePatches,
+	const ClusteredLighting* lighting) const
+{
+	drawProgram.Bind();
+	drawProgram.UploadMat4("u_view_projection_mat", viewProjection);
+	drawProgram.UploadVec3("u_camera_pos", cameraPos);
+	drawProgram.UploadFloat("u_world_size", worldSize);
+	drawProgram.UploadFloat("u_min_tess_level", minTessLevel);
+	drawProgram.UploadFloat("u_max_tess_level", maxTessLevel);
+	drawProgram.UploadFloat("u_min_distance", minDistance);
+	drawProgram.UploadFloat("u_max_distance", maxDistance);
+	drawProgram.UploadVec3("u_light_dir", glm::vec3(-0.4f, -1.0f, -0.3f));
+	drawProgram.UploadBool("u_clustered_lighting", lighting != nullptr);
+	if (lighting != nullptr)
+	{
+		lighting->Bind(drawProgram);
+	}
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, heightmapTexture);
+	glBindVertexArray(patchVAO);
+	glPatchParameteri(GL_PATCH_VERTICES, 4);
+	if (visiblePatches == nullptr)
+	{
+		glDrawArrays(GL_PATCHES, 0, patchesPerSide * patchesPerSide * 4);
+	}
+	else
+	{
+		// Neighbouring visible patches are merged into one range
+		std::vector<GLint> firsts;
+		std::vector<GLsizei> counts;
+		for (int patch = 0; patch < (int)visiblePatches->size(); patch++)
+		{
+			if (!(*visiblePatches)[patch])
+			{
+				continue;
+			}
+			if (!firsts.empty() && firsts.back() + counts.back() == patch * 4)
+			{
+				counts.back() += 4;
+			}
+			else
+			{
+				firsts.push_back(patch * 4);
+				counts.push_back(4);
+			}
+		}
+		glMultiDrawArrays(GL_PATCHES, firsts.data(), counts.data(), (GLsizei)firsts.size());
+	}
+	glBindVertexArray(0);
+	drawProgram.Unbind();
+}
+
+void Terrain::Destroy()
+{
+	glDeleteVertexArrays(1, &patchVAO);
+	glDeleteBuffers(1, &patchVBO);
+	glDeleteTextures(1, &heightmapTexture);
+	bakeProgram.Destroy();
+	drawProgram.Destroy();
+}
+
+void Terrain::ReadHeights(std::vector<float>& heights) const
+{
+	// GL_ALPHA isn't a valid format in the core profile, read everything and keep the heights
+	std::vector<glm::vec4> texels(heightmapResolution * heightmapResolution);
+	glBindTexture(GL_TEXTURE_2D, heightmapTexture);
+	glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, texels.data());
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	heights.resize(texels.size());
+	for (size_t i = 0; i < texels.size(); i++)
+	{
+		heights[i] = texels[i].w;
+	}
+}
+
+glm::vec2 Terrain::ReadHeightRange() const
+{
+	std::vector<float> heights;
+	ReadHeights(heights);
+
+	glm::vec2 range(FLT_MAX, -FLT_MAX);
+	for (float height : heights)
+	{
+		range.x = glm::min(range.x, height);
+		range.y = glm::max(range.y, height);
+	}
+	return range;
+}
+
+const BoundingBox* Terrain::PatchBoundsAt(const glm::vec3& position) const
+{
+	glm::vec2 uv = glm::vec2(position.x, position.z) / worldSize + glm::vec2(0.5f);
+	if (patchBounds.empty() || uv.x < 0.0f || uv.y < 0.0f || uv.x >= 1.0f || uv.y >= 1.0f)
+	{
+		return nullptr;
+	}
+
+	glm::ivec2 patch = glm::ivec2(uv * (float)patchesPerSide);
+	return &patchBounds[patch.y * patchesPerSide + patch.x];
+}
+
+// Private functions
+void Terrain::BuildCullingData()
+{
+	std::vector<float> heights;
+	ReadHeights(heights);
+
+	// Bounds of every patch, one extra texel on each side for the bilinear filtering in terrain.tes
+	const int numPatches = patchesPerSide * patchesPerSide;
+	const float patchSize = worldSize / patchesPerSide;
+	const float halfSize = worldSize * 0.5f;
+	patchBounds.resize(numPatches);
+	for (int z = 0; z < patchesPerSide; z++)
+	{
+		for (int x = 0; x < patchesPerSide; x++)
+		{
+			int texelMinX = glm::max(x * heightmapResolution / patchesPerSide - 1, 0);
+			int texelMaxX = glm::min((x + 1) * heightmapResolution / patchesPerSide, heightmapResolution - 1);
+			int texelMinZ = glm::max(z * heightmapResolution / patchesPerSide - 1, 0);
+			int texelMaxZ = glm::min((z + 1) * heightmapResolution / patchesPerSide, heightmapResolution - 1);
+
+			glm::vec2 range(FLT_MAX, -FLT_MAX);
+			for (int texelZ = texelMinZ; texelZ <= texelMaxZ; texelZ++)
+			{
+				for (int texelX = texelMinX; texelX <= texelMaxX; texelX++)
+				{
+					float height = heights[texelZ * heightmapResolution + texelX];
+					range.x = glm::min(range.x, height);
+					range.y = glm::max(range.y, height);
+				}
+			}
+
+			glm::vec2 corner(x * patchSize - halfSize, z * patchSize - halfSize);
+			patchBounds[z * patchesPerSide + x] = {
+				glm::vec3(corner.x, range.x, corner.y),
+				glm::vec3(corner.x + patchSize, range.y, corner.y + patchSize)
+			};
+		}
+	}
+
+	// A flat top at the lowest height of every patch plus walls where neighbours step up or down.
+	// Points on a shared edge belong to both patches, so the real surface there is above both tops.
+	occluderVertices.clear();
+	occluderIndices.clear();
+	auto addQuad = [this](const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3& d)
+	{
+		uint32 base = (uint32)occluderVertices.size();
+		occluderVertices.insert(occluderVertices.end(), { a, b, c, d });
+		occluderIndices.insert(occluderIndices.end(), { base, base + 1, base + 2, base + 2, base + 3, base });
+	};
+	for (int z = 0; z < patchesPerSide; z++)
+	{
+		for (int x = 0; x < patchesPerSide; x++)
+		{
+			const BoundingBox& bounds = patchBounds[z * patchesPerSide + x];
+			const float top = bounds.min.y;
+			addQuad(
+				glm::vec3(bounds.min.x, top, bounds.min.z), glm::vec3(bounds.max.x, top, bounds.min.z),
+				glm::vec3(bounds.max.x, top, bounds.max.z), glm::vec3(bounds.min.x, top, bounds.max.z));
+
+			if (x + 1 < patchesPerSide)
+			{
+				const float neighbourTop = patchBounds[z * patchesPerSide + x + 1].min.y;
+				const float low = glm::min(top, neighbourTop);
+				const float high = glm::max(top, neighbourTop);
+				addQuad(
+					glm::vec3(bounds.max.x, low, bounds.min.z), glm::vec3(bounds.max.x, low, bounds.max.z),
+					glm::vec3(bounds.max.x, high, bounds.max.z), glm::vec3(bounds.max.x, high, bounds.min.z));
+			}
+			if (z + 1 < patchesPerSide)
+			{
+				const float neighbourTop = patchBounds[(z + 1) * patchesPerSide + x].min.y;
+				const float low = glm::min(top, neighbourTop);
+				const float high = glm::max(top, neighbourTop);
+				addQuad(
+					glm::vec3(bounds.min.x, low, bounds.max.z), glm::vec3(bounds.max.x, low, bounds.max.z),
+					glm::vec3(bounds.max.x, high, bounds.max.z), glm::vec3(bounds.min.x, high, bounds.max.z));
+			}
+		}
+	}
+}
@@ -0,0 +1,93 @@
+#include "include/ThreadPool.h"
+
+void ThreadPool::Init(int numWorkers)
+{
+	if (numWorkers <= 0)
+	{
+		numWorkers = glm::max((int)std::thread::hardware_concurrency() - 1, 1);
+	}
+
+	stopping = false;
+	for (int i = 0; i < numWorkers; i++)
+	{
+		workers.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+void ThreadPool::Destroy()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wakeCondition.notify_all();
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+	workers.clear();
+}
+
+void ThreadPool::ParallelFor(int count, const std::function<void(int)>& task)
+{
+	if (workers.empty() || count <= 1)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			task(i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		currentTask = &task;
+		taskCount = count;
+		nextIndex = 0;
+		numBusyWorkers = (int)workers.size();
+		generation++;
+	}
+	wakeCondition.notify_all();
+
+	RunTasks();
+
+	// The task lives on our stack, so wait until every worker let go of it
+	std::unique_lock<std::mutex> lock(mutex);
+	doneCondition.wait(lock, [this]() { return numBusyWorkers == 0; });
+	currentTask = nullptr;
+}
+
+// Private functions
+void ThreadPool::RunTasks()
+{
+	int index;
+	while ((index = nextIndex.fetch_add(1)) < taskCount)
+	{
+		(*currentTask)(index);
+	}
+}
+
+void ThreadPool::WorkerLoop()
+{
+	uint64 lastGeneration = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeCondition.wait(lock, [&]() { return stopping || generation != lastGeneration; });
+			if (stopping)
+			{
+				return;
+			}
+			lastGeneration = generation;
+		}
+
+		RunTasks();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			numBusyWorkers--;
+		}
+		doneCondition.notify_one();
+	}
+}
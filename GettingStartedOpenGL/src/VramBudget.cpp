@@ -0,0 +1,204 @@
+#include "include/VramBudget.h"
+
+void VramBudget::AddTexture(const TrackedTexture& texture)
+{
+	RemoveTexture(texture.textureId);
+	textures.emplace(texture.textureId, texture);
+
+	uint64 size = ResidentSize(texture);
+	totalBytes += size;
+	bytesPerCategory[(size_t)texture.category] += size;
+}
+
+void VramBudget::RemoveTexture(uint32 textureId)
+{
+	auto iter = textures.find(textureId);
+	if (iter == textures.end())
+	{
+		return;
+	}
+
+	uint64 size = ResidentSize(iter->second);
+	totalBytes -= size;
+	bytesPerCategory[(size_t)iter->second.category] -= size;
+	textures.erase(iter);
+}
+
+void VramBudget::AddBuffer(const TrackedBuffer& buffer)
+{
+	// Re-specifying a buffer with glBufferData replaces its old storage
+	RemoveBuffer(buffer.bufferId);
+	buffers.emplace(buffer.bufferId, buffer);
+
+	totalBytes += buffer.size;
+	bytesPerCategory[(size_t)buffer.category] += buffer.size;
+}
+
+void VramBudget::RemoveBuffer(uint32 bufferId)
+{
+	auto iter = buffers.find(bufferId);
+	if (iter == buffers.end())
+	{
+		return;
+	}
+
+	totalBytes -= iter->second.size;
+	bytesPerCategory[(size_t)iter->second.category] -= iter->second.size;
+	buffers.erase(iter);
+}
+
+void VramBudget::MarkUsed(uint32 textureId, uint64 frame)
+{
+	auto iter = textures.find(textureId);
+	if (iter != textures.end())
+	{
+		iter->second.lastUsedFrame = frame;
+	}
+}
+
+void VramBudget::Update(uint64 frame, std::vector<ResidencyChange>& changes)
+{
+	// Restoring may use what the eviction below can take back from idle textures, never what a recently used one holds,
+	// otherwise two textures used on alternate frames keep evicting each other
+	uint64 reclaimableBytes = 0;
+	for (const auto& [textureId, texture] : textures)
+	{
+		if (IsIdle(texture, frame))
+		{
+			reclaimableBytes += ResidentSize(texture) - MipChainSize(texture.width, texture.height, texture.bytesPerPixel, texture.maxBaseLevel, texture.numLevels);
+		}
+	}
+
+	// Restore on demand, one level at a time so a texture gets back as much as the budget allows
+	for (auto& [textureId, texture] : textures)
+	{
+		if (texture.lastUsedFrame != frame)
+		{
+			continue;
+		}
+
+		int newBaseLevel = texture.residentBaseLevel;
+		uint64 currentSize = ResidentSize(texture);
+		while (newBaseLevel > 0)
+		{
+			uint64 restoredSize = MipChainSize(texture.width, texture.height, texture.bytesPerPixel, newBaseLevel - 1, texture.numLevels);
+			if (totalBytes - currentSize + restoredSize > budgetBytes + reclaimableBytes)
+			{
+				break;
+			}
+			newBaseLevel--;
+		}
+
+		if (newBaseLevel != texture.residentBaseLevel)
+		{
+			SetBaseLevel(texture, newBaseLevel, changes);
+		}
+	}
+
+	if (totalBytes <= budgetBytes)
+	{
+		return;
+	}
+
+	// Least recently used first, anything used in the last minIdleFrames frames is off limits
+	std::vector<TrackedTexture*> candidates;
+	for (auto& [textureId, texture] : textures)
+	{
+		if (IsIdle(texture, frame) && texture.residentBaseLevel < texture.maxBaseLevel)
+		{
+			candidates.push_back(&texture);
+		}
+	}
+	std::sort(candidates.begin(), candidates.end(), [](const TrackedTexture* a, const TrackedTexture* b)
+	{
+		return a->lastUsedFrame != b->lastUsedFrame ? a->lastUsedFrame < b->lastUsedFrame : a->textureId < b->textureId;
+	});
+
+	for (TrackedTexture* texture : candidates)
+	{
+		int newBaseLevel = texture->residentBaseLevel;
+		uint64 currentSize = ResidentSize(*texture);
+		uint64 newSize = currentSize;
+		while (newBaseLevel < texture->maxBaseLevel && totalBytes - currentSize + newSize > budgetBytes)
+		{
+			newBaseLevel++;
+			newSize = MipChainSize(texture->width, texture->height, texture->bytesPerPixel, newBaseLevel, texture->numLevels);
+		}
+
+		SetBaseLevel(*texture, newBaseLevel, changes);
+		if (totalBytes <= budgetBytes)
+		{
+			break;
+		}
+	}
+}
+
+uint64 VramBudget::MipChainSize(uint32 width, uint32 height, uint32 bytesPerPixel, int baseLevel, int numLevels)
+{
+	uint64 size = 0;
+	for (int level = baseLevel; level < numLevels; level++)
+	{
+		uint64 levelWidth = glm::max(width >> level, 1u);
+		uint64 levelHeight = glm::max(height >> level, 1u);
+		size += levelWidth * levelHeight * bytesPerPixel;
+	}
+	return size;
+}
+
+int VramBudget::NumMipLevels(uint32 width, uint32 height)
+{
+	int numLevels = 1;
+	uint32 size = glm::max(width, height);
+	while (size > 1)
+	{
+		size >>= 1;
+		numLevels++;
+	}
+	return numLevels;
+}
+
+uint64 VramBudget::ResidentSize(const TrackedTexture& texture)
+{
+	return MipChainSize(texture.width, texture.height, texture.bytesPerPixel, texture.residentBaseLevel, texture.numLevels);
+}
+
+const char* VramBudget::toString(ResourceCategory category)
+{
+	switch (category)
+	{
+	case ResourceCategory::Texture:
+		return "Texture";
+	case ResourceCategory::RenderTarget:
+		return "RenderTarget";
+	case ResourceCategory::VertexBuffer:
+		return "VertexBuffer";
+	case ResourceCategory::IndexBuffer:
+		return "IndexBuffer";
+	case ResourceCategory::UniformBuffer:
+		return "UniformBuffer";
+	case ResourceCategory::StorageBuffer:
+		return "StorageBuffer";
+	case ResourceCategory::PixelBuffer:
+		return "PixelBuffer";
+	case ResourceCategory::Count:
+		break;
+	}
+	return "Unknown";
+}
+
+// Private functions
+bool VramBudget::IsIdle(const TrackedTexture& texture, uint64 frame) const
+{
+	return texture.lastUsedFrame + glm::max(minIdleFrames, (uint64)1) <= frame;
+}
+
+void VramBudget::SetBaseLevel(TrackedTexture& texture, int newBaseLevel, std::vector<ResidencyChange>& changes)
+{
+	uint64 oldSize = ResidentSize(texture);
+	changes.push_back({ texture.textureId, texture.residentBaseLevel, newBaseLevel });
+	texture.residentBaseLevel = newBaseLevel;
+	uint64 newSize = ResidentSize(texture);
+
+	totalBytes = totalBytes - oldSize + newSize;
+	bytesPerCategory[(size_t)texture.category] = bytesPerCategory[(size_t)texture.category] - oldSize + newSize;
+}